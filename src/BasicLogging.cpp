@@ -2,10 +2,17 @@
 
 BasicLogging::BasicLogging() : Logging(LoggingLevel::BASIC) {}
 
-void BasicLogging::DisplayResult(TestResult& result)
+BasicLogging::~BasicLogging()
+{
+    Stop();
+}
+
+void BasicLogging::FormatResult(const TestResult& result, string& out)
 {
     // Log test name
-    cout << result.getTestName() << endl;
+    out += result.getTestName();
+    out += '\n';
     // Log PASS/FAIL to console.
-    cout << SuccessValue(result.getIsSuccessful()) << " - " << endl;
+    out += SuccessValue(result);
+    out += " - \n";
 }   
\ No newline at end of file
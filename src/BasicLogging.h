@@ -2,7 +2,7 @@
     BasicLogging.h
 
     This file contains the declaration and implementation of the BasicLogging class.
-    Concrete class that derives from Logging abstract class. Logs PASS/FAIL results to console.
+    Concrete class that derives from Logging abstract class. Formats PASS/FAIL results for the console.
 
 */
 
@@ -12,11 +12,6 @@
 #include "TestResult.h"
 #include "Logging.h"
 
-#include <iostream>
-
-using std::cout;
-using std::endl;
-
 /**
 * Displays a Basic test result
 **/
@@ -26,7 +21,13 @@ public:
 
     BasicLogging();
 
-    void DisplayResult(TestResult& result) override;
+    /**
+    * Writes the queued results before the formatter goes away
+    **/
+    ~BasicLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
 };
 
 #endif /* BasicLogging_h */
@@ -0,0 +1,274 @@
+/*
+	BenchmarkTest.cpp
+
+	This file contains the implementation of the BenchmarkTest and BenchmarkBaseline classes.
+
+	Baseline file layout, integers big-endian:
+		"TBSL"                      magic
+		uint32                      number of entries
+		per entry:
+			uint16                  length of test name
+			name bytes
+			uint64                  median nanoseconds per call, IEEE double bits
+*/
+
+#include "BenchmarkTest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using std::chrono::steady_clock;
+
+#if !defined(__GNUC__) && !defined(__clang__)
+volatile char benchmarkSink;
+#endif
+
+namespace
+{
+	const char Magic[4] = { 'T', 'B', 'S', 'L' };
+
+	void putInt(std::string& dst, unsigned long long value, int bytes)
+	{
+		for (int shift = 8 * (bytes - 1); shift >= 0; shift -= 8)
+			dst += static_cast<char>((value >> shift) & 0xff);
+	}
+
+	unsigned long long getInt(const unsigned char* p, int bytes)
+	{
+		unsigned long long value = 0;
+		for (int x = 0; x < bytes; x++)
+			value = (value << 8) | p[x];
+		return value;
+	}
+
+	// nanoseconds with four significant digits
+	string formatNs(double ns)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.4g ns", ns);
+		return text;
+	}
+}
+
+bool BenchmarkBaseline::load(const string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+	const unsigned char* end = p + data.size();
+
+	if (data.size() < 8 || !std::equal(Magic, Magic + 4, data.begin()))
+		return false;
+	unsigned long long count = getInt(p + 4, 4);
+	p += 8;
+
+	std::unordered_map<string, double> loaded;
+	for (unsigned long long x = 0; x < count; x++)
+	{
+		if (end - p < 2)
+			return false;
+		size_t nameLen = (size_t)getInt(p, 2);
+		if ((size_t)(end - p) < 2 + nameLen + 8)
+			return false;
+		string name(reinterpret_cast<const char*>(p + 2), nameLen);
+		unsigned long long bits = getInt(p + 2 + nameLen, 8);
+		double medianNs;
+		std::memcpy(&medianNs, &bits, sizeof(medianNs));
+		loaded[name] = medianNs;
+		p += 2 + nameLen + 8;
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	medians.swap(loaded);
+	return true;
+}
+
+bool BenchmarkBaseline::save(const string& path) const
+{
+	std::string data(Magic, 4);
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		putInt(data, medians.size(), 4);
+		for (auto& entry : medians)
+		{
+			// names longer than a uint16 length are cut; they still key consistently
+			size_t nameLen = entry.first.size() < 0xffff ? entry.first.size() : 0xffff;
+			unsigned long long bits;
+			std::memcpy(&bits, &entry.second, sizeof(bits));
+			putInt(data, nameLen, 2);
+			data.append(entry.first, 0, nameLen);
+			putInt(data, bits, 8);
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+	return (bool)out;
+}
+
+void BenchmarkBaseline::record(const string& testName, double medianNs)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	medians[testName] = medianNs;
+}
+
+double BenchmarkBaseline::median(const string& testName) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = medians.find(testName);
+	return iter == medians.end() ? -1 : iter->second;
+}
+
+BenchmarkTest::BenchmarkTest(const std::function<void()> bdy, string tstName, const string errMsg) : ITest(tstName, errMsg), body(bdy) {}
+
+void BenchmarkTest::setBaseline(BenchmarkBaseline* bsln, double thrshld)
+{
+	baseline = bsln;
+	threshold = thrshld;
+}
+
+double BenchmarkTest::timeBatch(size_t iterations)
+{
+	auto start = steady_clock::now();
+	for (size_t x = 0; x < iterations; x++)
+		body();
+	return std::chrono::duration<double, std::nano>(steady_clock::now() - start).count();
+}
+
+bool BenchmarkTest::run()
+{
+	CancellationToken token = getCancellationToken();
+	stats = BenchmarkStats();
+	details.clear();
+
+	// Calibrate while warming up: grow the batch until one takes at least
+	//	minSampleTime, then keep running batches until the warmup is over.
+	double minNs = std::chrono::duration<double, std::nano>(minSampleTime).count();
+	auto warmupEnd = steady_clock::now() + warmup;
+	size_t iterations = 1;
+	while (true)
+	{
+		if (token.isCancelled())
+			return false;
+		double elapsed = timeBatch(iterations);
+		if (elapsed < minNs)
+		{
+			// aim a little past minSampleTime, growing at most tenfold at a time
+			double scale = elapsed > 0 ? 1.2 * minNs / elapsed : 10;
+			iterations = (size_t)std::ceil(iterations * std::min(std::max(scale, 2.0), 10.0));
+		}
+		else if (steady_clock::now() >= warmupEnd)
+			break;
+	}
+
+	std::vector<double> perCall;
+	perCall.reserve(sampleCount);
+	for (size_t x = 0; x < sampleCount; x++)
+	{
+		if (token.isCancelled())
+			return false;
+		perCall.push_back(timeBatch(iterations) / iterations);
+	}
+
+	std::sort(perCall.begin(), perCall.end());
+	size_t n = perCall.size();
+	double sum = 0;
+	for (double ns : perCall)
+		sum += ns;
+	double mean = sum / n;
+	double squares = 0;
+	for (double ns : perCall)
+		squares += (ns - mean) * (ns - mean);
+
+	stats.samples = n;
+	stats.iterations = iterations;
+	stats.minNs = perCall.front();
+	stats.medianNs = n % 2 ? perCall[n / 2] : (perCall[n / 2 - 1] + perCall[n / 2]) / 2;
+	stats.p99Ns = perCall[(size_t)std::ceil(0.99 * n) - 1];
+	stats.meanNs = mean;
+	stats.stddevNs = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+	stats.opsPerSecond = mean > 0 ? 1e9 / mean : 0;
+
+	char throughput[64];
+	snprintf(throughput, sizeof(throughput), "%.4g calls/sec (%zu samples of %zu calls)",
+		stats.opsPerSecond, stats.samples, stats.iterations);
+	details = "min " + formatNs(stats.minNs) + ", median " + formatNs(stats.medianNs) + ", p99 " + formatNs(stats.p99Ns)
+		+ ", stddev " + formatNs(stats.stddevNs) + ", " + throughput;
+
+	if (baseline == nullptr)
+		return true;
+	double baselineNs = baseline->median(getTestName());
+	if (baselineNs < 0)
+	{
+		baseline->record(getTestName(), stats.medianNs);
+		details += "\nno baseline; recorded this median";
+		return true;
+	}
+	char change[128];
+	double slowdown = stats.medianNs / baselineNs - 1;
+	snprintf(change, sizeof(change), "\nbaseline median %s, change %+.1f%%, threshold %.1f%%",
+		formatNs(baselineNs).c_str(), slowdown * 100, threshold * 100);
+	details += change;
+	return slowdown <= threshold;
+}
+
+#ifdef TEST_BENCHMARKTEST
+
+#include "TestHarness.h"
+#include "DetailedLogging.h"
+#include <iostream>
+#include <numeric>
+
+int main()
+{
+	std::cout << "\n  Demonstrating BenchmarkTest";
+	std::cout << "\n =============================\n\n";
+
+	std::vector<int> values(1000);
+	std::iota(values.begin(), values.end(), 0);
+	BenchmarkTest sum([&]() {
+		int total = 0;
+		for (int value : values)
+			total += value;
+		doNotOptimize(total);
+	}, "sum 1000 ints", "Benchmark regressed");
+
+	BenchmarkTest copy([&]() {
+		std::vector<int> copied(values);
+		doNotOptimize(copied.data());
+		clobberMemory();
+	}, "copy 1000 ints", "Benchmark regressed");
+
+	// pretend an earlier run summed ten times faster, so this one regressed
+	BenchmarkBaseline baseline;
+	sum.setBaseline(&baseline, 0.1);
+	// allocating is noisier, so allow more
+	copy.setBaseline(&baseline, 0.5);
+	sum.run();
+	baseline.record("sum 1000 ints", sum.getStats().medianNs / 10);
+
+	// benchmarks sharing the machine would slow each other down
+	TestHarness harness(new DetailedLogging);
+	harness.setHistoryFile("");
+	harness.setWorkerCount(1);
+	harness.addTest(&sum);
+	harness.addTest(&copy);
+	harness.run();
+
+	// copy now has a recorded baseline to compare against
+	harness.run();
+
+	baseline.save("BenchmarkTest.test");
+	BenchmarkBaseline reloaded;
+	reloaded.load("BenchmarkTest.test");
+	std::cout << "\n  reloaded baseline for copy: " << reloaded.median("copy 1000 ints") << " ns";
+	std::cout << "\n\n";
+	std::remove("BenchmarkTest.test");
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*
+	BenchmarkTest.h
+
+	This file contains the declaration of the BenchmarkTest and BenchmarkBaseline classes.
+	Derives from ITest interface class. Runs a callable many times and reports
+	statistics about how long one call takes, so the harness can run performance
+	regression tests alongside functional ones.
+
+	A run warms up, picks an iteration count so each timed sample is long enough
+	to measure, then takes a fixed number of samples. The statistics become part
+	of the result message, so the Logging levels that show messages show them.
+	If a baseline is given, the test fails when its median is slower than the
+	baseline's by more than the threshold.
+*/
+
+#pragma once
+
+#include "ITest.h"
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <vector>
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#include <intrin.h>
+extern volatile char benchmarkSink;
+#endif
+
+/**
+* Makes the compiler assume value is read, so the work producing it
+* can't be optimized away
+**/
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	benchmarkSink = *reinterpret_cast<const volatile char*>(&value);
+	_ReadWriteBarrier();
+#endif
+}
+
+/**
+* Makes the compiler assume all memory is read and written, so stores
+* the benchmark made can't be optimized away
+**/
+inline void clobberMemory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : : "memory");
+#else
+	_ReadWriteBarrier();
+#endif
+}
+
+/**
+* Statistics of one benchmark run. Times are per call in nanoseconds
+**/
+struct BenchmarkStats
+{
+	size_t samples = 0;
+	size_t iterations = 0;
+	double minNs = 0;
+	double medianNs = 0;
+	double p99Ns = 0;
+	double meanNs = 0;
+	double stddevNs = 0;
+	double opsPerSecond = 0;
+};
+
+/**
+* Median time per call of each benchmark, kept per test name in a small
+* binary file, for comparing later runs against
+**/
+class BenchmarkBaseline
+{
+public:
+	/**
+	* Reads medians from a baseline file. A missing or unreadable file
+	* leaves the baseline empty. Returns true if the file was read.
+	*
+	* @path[in] - baseline file to read
+	**/
+	bool load(const string& path);
+
+	/**
+	* Writes all medians to a baseline file. Returns false on failure.
+	*
+	* @path[in] - baseline file to write
+	**/
+	bool save(const string& path) const;
+
+	/**
+	* Sets the median for a benchmark, replacing any earlier one
+	*
+	* @testName[in] - name of the benchmark
+	* @medianNs[in] - median time per call in nanoseconds
+	**/
+	void record(const string& testName, double medianNs);
+
+	/**
+	* Returns the median for a benchmark in nanoseconds, or a negative
+	* value if it has none
+	*
+	* @testName[in] - name of the benchmark
+	**/
+	double median(const string& testName) const;
+
+private:
+	std::unordered_map<string, double> medians;
+	mutable std::mutex mtx;
+};
+
+/**
+* Runs a callable repeatedly and measures it
+**/
+class BenchmarkTest : public ITest
+{
+public:
+	BenchmarkTest(const std::function<void()> bdy, string tstName, const string errMsg);
+
+	/**
+	* Sets how long to run before sampling, to warm caches and clocks
+	**/
+	void setWarmup(std::chrono::milliseconds time) { warmup = time; }
+
+	/**
+	* Sets how many timed samples to take
+	**/
+	void setSampleCount(size_t count) { sampleCount = count < 1 ? 1 : count; }
+
+	/**
+	* Sets the shortest a sample may be; iterations per sample are
+	* raised until a sample takes at least this long
+	**/
+	void setMinSampleTime(std::chrono::microseconds time) { minSampleTime = time; }
+
+	/**
+	* Compares each run against a baseline. A benchmark without a median
+	* in the baseline passes and has its median recorded there
+	*
+	* @bsln[in] - baseline to compare against; must outlive the test
+	* @thrshld[in] - allowed slowdown of the median, e.g. 0.1 for 10%
+	**/
+	void setBaseline(BenchmarkBaseline* bsln, double thrshld);
+
+	/**
+	* Returns the statistics of the last run
+	**/
+	const BenchmarkStats& getStats() const { return stats; }
+
+	/**
+	* Returns false if the median regressed against the baseline or the
+	* run was cancelled
+	**/
+	bool run() override;
+
+	/**
+	* Returns the statistics of the last run as text
+	**/
+	string getDetails() const override { return details; }
+private:
+	// times iterations calls, returning nanoseconds
+	double timeBatch(size_t iterations);
+
+	// function that is measured
+	std::function<void()> body;
+	std::chrono::milliseconds warmup{ 50 };
+	size_t sampleCount = 30;
+	std::chrono::microseconds minSampleTime{ 1000 };
+	BenchmarkBaseline* baseline = nullptr;
+	double threshold = 0;
+	BenchmarkStats stats;
+	string details;
+};
@@ -0,0 +1,237 @@
+/*
+	CallableTest.cpp
+
+	This file contains the implementation of the TestTable class. CallableTest is a
+	class template, implemented in CallableTest.h. Compile with BENCH_CALLABLETEST
+	for the dispatch benchmark.
+*/
+
+#include "CallableTest.h"
+
+TestTable::TestTable(const TestEntry* entries, size_t cnt) : first(std::allocator<EntryTest>().allocate(cnt)), count(0)
+{
+	try
+	{
+		for (; count < cnt; count++)
+			new (first + count) EntryTest(entries[count].run, entries[count].name, entries[count].errorMessage);
+	}
+	catch (...)
+	{
+		for (size_t x = 0; x < count; x++)
+			first[x].~EntryTest();
+		std::allocator<EntryTest>().deallocate(first, cnt);
+		throw;
+	}
+}
+
+TestTable::~TestTable()
+{
+	for (size_t x = 0; x < count; x++)
+		first[x].~EntryTest();
+	std::allocator<EntryTest>().deallocate(first, count);
+}
+
+std::vector<ITest*> TestTable::tests()
+{
+	std::vector<ITest*> all;
+	all.reserve(count);
+	for (size_t x = 0; x < count; x++)
+		all.push_back(first + x);
+	return all;
+}
+
+#ifdef BENCH_CALLABLETEST
+
+#include "LambdaTest.h"
+#include "TestHarness.h"
+#include "Logging.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <utility>
+
+/////////////////////////////////////////////////////////////////////
+// Builds count tiny tests, 100000 by default, three ways: LambdaTest
+// with a capturing lambda, CallableTest with the same lambda, and a
+// TestTable of functions. Reports heap allocations and time to build
+// them, the time per ITest::run called directly, and the time per
+// test through the harness.
+//
+// Run with argument "[count]".
+
+std::atomic<size_t> allocations{ 0 };
+
+// every other form goes through these two, so each allocation is
+//	counted once and freed by the function that matches it
+void* operator new(size_t size)
+{
+	++allocations;
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+// once inlined where a constructor can throw, gcc pairs the free below
+//	with the operator new call and takes them for a mismatch
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+void* operator new[](size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	::operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	::operator delete(p);
+}
+
+// discards results
+class NullLogging : public Logging
+{
+public:
+	NullLogging() : Logging(LoggingLevel::BASIC) {}
+	~NullLogging() override { Stop(); }
+	void DisplayResult(TestResult&) override {}
+protected:
+	void FormatResult(const TestResult&, string&) override {}
+};
+
+template <int N>
+bool tinyTest()
+{
+	return N % 97 != 96;
+}
+
+template <int... N>
+constexpr std::pair<const char*, bool (*)()> tinyTestAt(size_t x, std::integer_sequence<int, N...>)
+{
+	constexpr bool (*functions[])() = { &tinyTest<N>... };
+	return { "tiny test", functions[x % sizeof...(N)] };
+}
+
+struct Timing
+{
+	size_t allocations;
+	double buildNs;
+	double runNs;
+	double harnessNs;
+};
+
+template <typename Build>
+Timing measure(size_t count, Build build)
+{
+	using clock = std::chrono::steady_clock;
+	Timing timing;
+	size_t allocated = allocations;
+	auto start = clock::now();
+	auto suite = build();
+	timing.buildNs = std::chrono::duration<double, std::nano>(clock::now() - start).count() / count;
+	timing.allocations = allocations - allocated;
+
+	std::vector<ITest*> tests = suite.tests();
+	const int Passes = 10;
+	size_t passed = 0;
+	start = clock::now();
+	for (int pass = 0; pass < Passes; pass++)
+		for (ITest* test : tests)
+			passed += test->run();
+	timing.runNs = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (count * Passes);
+	if (passed == 0)
+		std::cout << "";
+
+	TestHarness harness(new NullLogging);
+	harness.setHistoryFile("");
+	for (ITest* test : tests)
+		harness.addTest(test);
+	start = clock::now();
+	harness.run();
+	timing.harnessNs = std::chrono::duration<double, std::nano>(clock::now() - start).count() / count;
+	return timing;
+}
+
+// owns a suite of tests built one at a time
+template <typename Test>
+struct Suite
+{
+	std::vector<std::unique_ptr<Test>> owned;
+	std::vector<ITest*> tests()
+	{
+		std::vector<ITest*> all;
+		for (auto& test : owned)
+			all.push_back(test.get());
+		return all;
+	}
+};
+
+// the same small capturing lambda for both LambdaTest and CallableTest;
+//	three captures are too big for std::function to store inline
+auto makeCheck = [](long long low, long long high, long long value) {
+	return [low, high, value]() { return value % 97 < high - low; };
+};
+using Check = decltype(makeCheck(0, 0, 0));
+
+int main(int argc, char* argv[])
+{
+	size_t count = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+	Timing lambda = measure(count, [count]() {
+		Suite<LambdaTest> suite;
+		suite.owned.reserve(count);
+		for (size_t x = 0; x < count; x++)
+			suite.owned.emplace_back(new LambdaTest(makeCheck(10, 30, (long long)x), "tiny test", "failed"));
+		return suite;
+	});
+
+	Timing callable = measure(count, [count]() {
+		Suite<CallableTest<Check>> suite;
+		suite.owned.reserve(count);
+		for (size_t x = 0; x < count; x++)
+			suite.owned.push_back(makeCallableTest(makeCheck(10, 30, (long long)x), "tiny test", "failed"));
+		return suite;
+	});
+
+	std::vector<TestEntry> entries;
+	for (size_t x = 0; x < count; x++)
+	{
+		auto entry = tinyTestAt(x, std::make_integer_sequence<int, 256>());
+		entries.push_back(TestEntry{ entry.first, entry.second, "failed" });
+	}
+	Timing table = measure(count, [&entries]() { return TestTable(entries.data(), entries.size()); });
+
+	std::cout << "\n  " << count << " tiny tests";
+	std::cout << "\n  -----------------------------------------------------------------";
+	std::cout << "\n                  allocations   build ns   run ns   harness ns";
+	std::pair<const char*, Timing*> rows[] = { { "LambdaTest  ", &lambda }, { "CallableTest", &callable }, { "TestTable   ", &table } };
+	for (auto& row : rows)
+	{
+		char line[128];
+		snprintf(line, sizeof(line), "\n  %s    %9zu   %8.1f   %6.2f   %10.1f", row.first,
+			row.second->allocations, row.second->buildNs, row.second->runNs, row.second->harnessNs);
+		std::cout << line;
+	}
+	std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+	CallableTest.h
+
+	This file contains the declaration and implementation of the CallableTest class template
+	and the TestTable class. Derive from ITest interface class. Provide an infrastructure for
+	passing tests to the test harness without std::function.
+
+	CallableTest stores its lambda, functor or function pointer inline, so the callable
+	is never copied to the heap, and running one is the ITest::run virtual call with the
+	callable inlined into it.
+
+	TEST_TABLE lays out a table of test functions at compile time:
+
+		bool addsUp() { return 1 + 1 == 2; }
+		bool multiplies() { return 2 * 3 == 6; }
+
+		TEST_TABLE(arithmeticTests,
+			TEST_ENTRY(addsUp),
+			TEST_ENTRY(multiplies));
+
+		TestTable table(arithmeticTests);
+		for (ITest* test : table.tests())
+			harness.addTest(test);
+
+	TestTable builds one test per entry, side by side in a single allocation.
+*/
+
+#pragma once
+
+#include "ITest.h"
+#include <vector>
+#include <memory>
+#include <utility>
+
+/**
+* Runs a callable stored in the test as a test
+**/
+template <typename F>
+class CallableTest : public ITest
+{
+public:
+	CallableTest(F clbl, string tstName, const string errMsg) : ITest(tstName, errMsg), callable(std::move(clbl)) {}
+
+	bool run() override { return callable(); }
+private:
+	// lambda, functor or function pointer to run as test
+	F callable;
+};
+
+/**
+* Returns a CallableTest for callable, deducing its type
+**/
+template <typename F>
+std::unique_ptr<CallableTest<F>> makeCallableTest(F callable, string tstName, const string errMsg)
+{
+	return std::unique_ptr<CallableTest<F>>(new CallableTest<F>(std::move(callable), tstName, errMsg));
+}
+
+/**
+* One test in a table built with TEST_TABLE
+**/
+struct TestEntry
+{
+	const char* name;
+	bool (*run)();
+	const char* errorMessage;
+};
+
+/**
+* Makes an entry for a bool() function, named after it
+**/
+#define TEST_ENTRY(function) TestEntry{ #function, &function, #function " failed" }
+
+/**
+* Defines table as a constant array of the given entries
+**/
+#define TEST_TABLE(table, ...) constexpr TestEntry table[] = { __VA_ARGS__ }
+
+/**
+* Tests for the entries of a table, constructed contiguously
+**/
+class TestTable
+{
+public:
+	template <size_t N>
+	explicit TestTable(const TestEntry (&entries)[N]) : TestTable(entries, N) {}
+	TestTable(const TestEntry* entries, size_t count);
+	~TestTable();
+
+	TestTable(const TestTable&) = delete;
+	TestTable& operator=(const TestTable&) = delete;
+
+	/**
+	* Returns the number of tests
+	**/
+	size_t size() const { return count; }
+
+	/**
+	* Returns the tests in table order, e.g. for TestHarness::addTest
+	**/
+	std::vector<ITest*> tests();
+private:
+	using EntryTest = CallableTest<bool (*)()>;
+
+	EntryTest* first;
+	size_t count;
+};
@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////
 // Comm.h - message-passing communication facility                 //
-// ver 1.0                                                         //
+// ver 1.8                                                         //
 // Jim Fawcett, CSE687-OnLine Object Oriented Design, Fall 2017    //
 /////////////////////////////////////////////////////////////////////
 
@@ -10,10 +10,28 @@
 #include "Cpp11-BlockingQueue.h"
 #include <iostream>
 #include <functional>
+#ifdef _WIN32
 #include <conio.h>
+#endif
 #include <thread> 
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 using std::thread;
 using std::vector;
@@ -25,6 +43,79 @@ using namespace MsgPassingCommunication;
 using namespace Sockets;
 using SUtils = Utilities::StringHelper;
 
+// first line a Sender writes on a new connection when framing in binary
+const std::string BinaryPreamble = "wire-format:binary\n";
+
+// attribute a Sender adds to a file Message; its bytes follow the Message
+const std::string FileSizeKey = "file-size";
+
+// a receiver enQs a progress Message each time this much file has arrived
+const size_t FileProgressChunk = 64 * 1024 * 1024;
+
+// a pooled connection unused this long is checked for a closed peer
+//  before reuse; sooner than this the check would cost more than it saves
+const std::chrono::milliseconds StaleCheckAfter(1000);
+
+//----< portable file descriptor operations used for file transfer >-
+
+namespace
+{
+  int openFile(const std::string& path, bool forWriting)
+  {
+#ifdef _WIN32
+    return forWriting
+      ? ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)
+      : ::_open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    return forWriting
+      ? ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+      : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+  }
+
+  bool fileSize(int fileDescriptor, size_t& size)
+  {
+#ifdef _WIN32
+    struct _stat64 info;
+    if (::_fstat64(fileDescriptor, &info) != 0)
+      return false;
+#else
+    struct stat info;
+    if (::fstat(fileDescriptor, &info) != 0)
+      return false;
+#endif
+    size = (size_t)info.st_size;
+    return true;
+  }
+
+  void closeFile(int fileDescriptor)
+  {
+#ifdef _WIN32
+    ::_close(fileDescriptor);
+#else
+    ::close(fileDescriptor);
+#endif
+  }
+
+  // progress of a file arriving after fileMsg, saved at path
+  Message fileProgressMessage(const Message& fileMsg, const std::string& path, size_t received, size_t size)
+  {
+    Message progress(fileMsg.to(), fileMsg.from());
+    progress.name("file-progress");
+    progress.file(path);
+    progress.attribute("received", std::to_string(received));
+    progress.attribute(FileSizeKey, std::to_string(size));
+    return progress;
+  }
+
+  // strips directories, so a sender can't write outside fileDirectory
+  std::string baseName(const std::string& path)
+  {
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+  }
+}
+
 //----< constructor sets port >--------------------------------------
 
 Receiver::Receiver(EndPoint ep, const std::string& name) : listener(ep.port), rcvrName(name)
@@ -40,9 +131,9 @@ BlockingQueue<Message>* Receiver::queue()
 //----< starts listener thread running callable object >-------------
 
 template<typename CallableObject>
-void Receiver::start(CallableObject& co)
+bool Receiver::start(CallableObject& co)
 {
-  listener.start(co);
+  return listener.start(co);
 }
 //----< stops listener thread >--------------------------------------
 
@@ -57,11 +148,10 @@ Message Receiver::getMessage()
   StaticLogger<1>::write("\n  -- " + rcvrName + " deQing message");
   return rcvQ.deQ();
 }
-//----< constructor initializes endpoint object >--------------------
+//----< constructor names the sender >------------------------------
 
 Sender::Sender(const std::string& name) : sndrName(name)
 {
-  lastEP = EndPoint();  // used to detect change in destination
 }
 //----< destructor waits for send thread to terminate >--------------
 
@@ -75,69 +165,340 @@ Sender::~Sender()
 void Sender::start()
 {
   std::function <void()> threadProc = [&]() {
+    std::vector<Message> msgs;
     while (true)
     {
-      Message msg = sndQ.deQ();
-
-      if (msg.command() == "quit")
+      msgs.clear();
+      msgs.push_back(sndQ.deQ());
+      collectBatch(msgs);
+      evictIdle();
+      if (!sendBatch(msgs))
       {
         StaticLogger<1>::write("\n  -- send thread shutting down");
+        pool_.clear();
         return;
       }
-      StaticLogger<1>::write("\n  -- " + sndrName + " send thread sending " + msg.name());
-      std::string msgStr = msg.toString();
-
-      if (msg.to().address != lastEP.address || msg.to().port != lastEP.port)
-      {
-        connecter.shutDown();
-        //connecter.close();
-        StaticLogger<1>::write("\n  -- attempting to connect to new endpoint: " + msg.to().toString());
-        if (!connect(msg.to()))
-        {
-          StaticLogger<1>::write("\n can't connect");
-          continue;
-        }
-        else
-        {
-          StaticLogger<1>::write("\n  connected to " + msg.to().toString());
-        }
-      }
-      bool sendRslt = connecter.send(msgStr.length(), (Socket::byte*)msgStr.c_str());
     }
   };
   std::thread t(threadProc);
   sendThread = std::move(t);
 }
-//----< stops send thread by posting quit message >------------------
+//----< adds queued messages to msgs, up to batchSize >--------------
+/*
+*  - takes only what is already queued unless flushDeadline is set, in
+*    which case it waits up to that long after the first message
+*/
+void Sender::collectBatch(std::vector<Message>& msgs)
+{
+  if (msgs.size() < batchSize_)
+    sndQ.deQAll(msgs, batchSize_ - msgs.size());
+  if (flushDeadline_.count() == 0)
+    return;
 
+  auto deadline = std::chrono::steady_clock::now() + flushDeadline_;
+  Message msg;
+  while (msgs.size() < batchSize_ && msgs.back().command() != "quit")
+  {
+    auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+      deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0 || !sndQ.tryDeQ(msg, remaining))
+      return;
+    msgs.push_back(std::move(msg));
+    sndQ.deQAll(msgs, batchSize_ - msgs.size());
+  }
+}
+//----< sends msgs in order, one write per destination >-------------
+/*
+*  - messages for the same endpoint are gathered until a file message
+*    or quit, which must follow everything posted before it
+*  - returns false when msgs holds the quit message
+*/
+bool Sender::sendBatch(std::vector<Message>& msgs)
+{
+  std::vector<Batch> batches;
+  for (Message& msg : msgs)
+  {
+    if (msg.command() == "quit")
+    {
+      flush(batches);
+      return false;
+    }
+    StaticLogger<1>::write("\n  -- " + sndrName + " send thread sending " + msg.name());
+    if (!msg.file().empty())
+    {
+      flush(batches);
+      sendFile(msg);
+      continue;
+    }
+    std::string key = msg.to().toString();
+    auto batch = batches.begin();
+    while (batch != batches.end() && batch->to.toString() != key)
+      ++batch;
+    if (batch == batches.end())
+    {
+      batches.push_back(Batch{ msg.to(), {} });
+      batch = batches.end() - 1;
+    }
+    batch->frames.push_back(frame(msg));
+  }
+  flush(batches);
+  return true;
+}
+//----< writes each batch to its endpoint, then empties batches >----
+
+void Sender::flush(std::vector<Batch>& batches)
+{
+  for (Batch& batch : batches)
+  {
+    if (!sendFrames(batch.to, batch.frames))
+      StaticLogger<1>::write("\n  -- " + sndrName + " failed sending to " + batch.to.toString());
+  }
+  batches.clear();
+}
+//----< sends frames on the pooled connection to ep in one write >---
+/*
+*  - the peer may have closed a pooled connection while it sat idle,
+*    so a failed send on one is retried once on a new connection
+*/
+bool Sender::sendFrames(const EndPoint& ep, const std::vector<std::string>& frames)
+{
+  bool reused = pool_.find(ep.toString()) != pool_.end();
+  SocketConnecter* pConnecter = connection(ep);
+  bool sent = pConnecter && pConnecter->sendBuffers(frames);
+  if (!sent && pConnecter && reused)
+  {
+    dropConnection(ep);
+    pConnecter = connection(ep);
+    sent = pConnecter && pConnecter->sendBuffers(frames);
+  }
+  if (sent)
+  {
+    messages_ += frames.size();
+    ++writes_;
+  }
+  return sent;
+}
+//----< serializes msg in the selected wire format >-----------------
+
+std::string Sender::frame(const Message& msg)
+{
+  return (wireFormat_ == WireFormat::binary) ? msg.toBinary() : msg.toString();
+}
+//----< sends a single message on the pooled connection >------------
+
+bool Sender::sendMessage(const Message& msg)
+{
+  return sendFrames(msg.to(), std::vector<std::string>{ frame(msg) });
+}
+//----< sends message followed by the file it names >----------------
+/*
+*  - the file goes from the page cache to the socket without being read
+*    into this process
+*  - a transfer that fails part way leaves the stream unframed, so the
+*    connection is dropped and the next message reconnects
+*/
+bool Sender::sendFile(Message& msg)
+{
+  std::string path = msg.file();
+  int fileDescriptor = openFile(path, false);
+  size_t size = 0;
+  if (fileDescriptor == -1 || !fileSize(fileDescriptor, size))
+  {
+    StaticLogger<1>::write("\n  -- " + sndrName + " can't open " + path);
+    if (fileDescriptor != -1)
+      closeFile(fileDescriptor);
+    return false;
+  }
+  msg.file(baseName(path));
+  msg.attribute(FileSizeKey, std::to_string(size));
+
+  bool sent = sendMessage(msg) && connection(msg.to())->sendFile(fileDescriptor, 0, size);
+  closeFile(fileDescriptor);
+  if (!sent)
+  {
+    StaticLogger<1>::write("\n  -- " + sndrName + " failed sending " + path);
+    dropConnection(msg.to());
+  }
+  return sent;
+}
+//----< stops send thread by posting quit message >------------------
+/*
+*  - messages posted earlier are still sent; the send thread closes
+*    its connections when it reaches the quit message
+*/
 void Sender::stop()
 {
   Message msg;
   msg.name("quit");
   msg.command("quit");
   postMessage(msg);
-  connecter.shutDown();
 }
 //----< attempts to connect to endpoint ep >-------------------------
-
+/*
+*  - reuses a pooled connection if there is one
+*/
 bool Sender::connect(EndPoint ep)
 {
-  lastEP = ep;
-  return connecter.connect(ep.address, ep.port);
+  return connection(ep) != nullptr;
 }
-//----< posts message to send queue >--------------------------------
+//----< returns pooled connection to ep, connecting if needed >------
+/*
+*  - announces binary framing, if selected, before any messages
+*  - a full pool closes its least recently used connection first
+*  - returns nullptr if ep can't be reached
+*/
+SocketConnecter* Sender::connection(const EndPoint& ep)
+{
+  auto now = std::chrono::steady_clock::now();
+  std::string key = ep.toString();
+  auto pooled = pool_.find(key);
+  if (pooled != pool_.end() && now - pooled->second.lastUsed > StaleCheckAfter
+    && pooled->second.connecter->peerClosed())
+  {
+    pool_.erase(pooled);
+    pooled = pool_.end();
+  }
+  if (pooled != pool_.end())
+  {
+    pooled->second.lastUsed = now;
+    return pooled->second.connecter.get();
+  }
 
-void Sender::postMessage(Message msg)
+  while (!pool_.empty() && pool_.size() >= maxConnections_)
+  {
+    auto oldest = pool_.begin();
+    for (auto iter = pool_.begin(); iter != pool_.end(); ++iter)
+      if (iter->second.lastUsed < oldest->second.lastUsed)
+        oldest = iter;
+    pool_.erase(oldest);
+  }
+
+  StaticLogger<1>::write("\n  -- attempting to connect to new endpoint: " + key);
+  std::unique_ptr<SocketConnecter> pConnecter(new SocketConnecter);
+  if (!pConnecter->connect(ep.address, ep.port))
+  {
+    StaticLogger<1>::write("\n can't connect");
+    return nullptr;
+  }
+  ++connects_;
+  if (wireFormat_ == WireFormat::binary
+    && !pConnecter->send(BinaryPreamble.length(), (Socket::byte*)BinaryPreamble.c_str()))
+    return nullptr;
+  StaticLogger<1>::write("\n  connected to " + key);
+
+  Connection& pooledConnection = pool_[key];
+  pooledConnection.connecter = std::move(pConnecter);
+  pooledConnection.lastUsed = now;
+  return pooledConnection.connecter.get();
+}
+//----< closes the pooled connection to ep, if any >-----------------
+
+void Sender::dropConnection(const EndPoint& ep)
 {
-  sndQ.enQ(msg);
+  pool_.erase(ep.toString());
+}
+//----< closes connections unused for longer than idleTimeout >------
+
+void Sender::evictIdle()
+{
+  auto cutoff = std::chrono::steady_clock::now() - idleTimeout_;
+  for (auto iter = pool_.begin(); iter != pool_.end();)
+  {
+    if (iter->second.lastUsed < cutoff)
+      iter = pool_.erase(iter);
+    else
+      ++iter;
+  }
 }
-//----< sends binary file >------------------------------------------
+//----< get and set connection pool limits >-------------------------
 /*
-*  - not implemented yet
+*  - set before start()
 */
-bool Sender::sendFile(const std::string& fileName)
+size_t Sender::maxConnections()
+{
+  return maxConnections_;
+}
+
+void Sender::maxConnections(size_t max)
 {
-  return false;
+  maxConnections_ = (std::max)(max, (size_t)1);
+}
+
+std::chrono::milliseconds Sender::idleTimeout()
+{
+  return idleTimeout_;
+}
+
+void Sender::idleTimeout(std::chrono::milliseconds timeout)
+{
+  idleTimeout_ = timeout;
+}
+//----< number of connections opened so far >-----------------------
+
+size_t Sender::connectCount()
+{
+  return connects_;
+}
+//----< get and set batching limits >-------------------------------
+/*
+*  - set before start()
+*  - a batch size of one sends each message with its own write
+*  - a zero flush deadline never delays a message
+*/
+size_t Sender::batchSize()
+{
+  return batchSize_;
+}
+
+void Sender::batchSize(size_t size)
+{
+  batchSize_ = (std::max)(size, (size_t)1);
+}
+
+std::chrono::microseconds Sender::flushDeadline()
+{
+  return flushDeadline_;
+}
+
+void Sender::flushDeadline(std::chrono::microseconds deadline)
+{
+  flushDeadline_ = deadline;
+}
+//----< messages sent, writes used, and messages per write >---------
+
+size_t Sender::messageCount()
+{
+  return messages_;
+}
+
+size_t Sender::writeCount()
+{
+  return writes_;
+}
+
+double Sender::averageBatchSize()
+{
+  size_t writes = writes_;
+  return writes == 0 ? 0.0 : (double)messages_ / writes;
+}
+//----< get and set framing used for new connections >---------------
+/*
+*  - set before start(); pooled connections keep their framing
+*/
+WireFormat Sender::wireFormat()
+{
+  return wireFormat_;
+}
+
+void Sender::wireFormat(WireFormat wf)
+{
+  wireFormat_ = wf;
+}
+//----< posts message to send queue >--------------------------------
+
+void Sender::postMessage(Message msg)
+{
+  sndQ.enQ(msg);
 }
 //----< callable object posts incoming message to rcvQ >-------------
 /*
@@ -149,7 +510,8 @@ class ClientHandler
 public:
   //----< acquire reference to shared rcvQ >-------------------------
 
-  ClientHandler(BlockingQueue<Message>* pQ, const std::string& name = "clientHandler") : pQ_(pQ), clientHandlerName(name)
+  ClientHandler(BlockingQueue<Message>* pQ, const std::string& name = "clientHandler", const std::string& fileDirectory = ".")
+    : pQ_(pQ), clientHandlerName(name), fileDirectory_(fileDirectory)
   {
     StaticLogger<1>::write("\n  -- starting ClientHandler");
   }
@@ -166,10 +528,12 @@ public:
     pQ_ = pQ;
   }
   //----< frame message string by reading bytes from socket >--------
-
-  std::string readMsg(Socket& socket)
+  /*
+  *  - firstLine holds an attribute line already read from the socket
+  */
+  std::string readMsg(Socket& socket, const std::string& firstLine = "")
   {
-    std::string temp, msgString;
+    std::string temp, msgString = firstLine;
     while (socket.validState())
     {
       temp = socket.recvString('\n');  // read attribute
@@ -179,20 +543,95 @@ public:
     }
     return msgString;
   }
-  //----< reads messages from socket and enQs in rcvQ >--------------
+  //----< frame binary message with a header read and a payload read >
+
+  bool readBinaryMsg(Socket& socket, Message& msg)
+  {
+    Socket::byte header[Message::BinaryHeaderSize];
+    if (!socket.recv(Message::BinaryHeaderSize, header))
+      return false;
+    size_t length = Message::binaryPayloadLength(header);
+    if (length > MaxBinaryPayload)
+    {
+      StaticLogger<1>::write("\n  -- " + clientHandlerName + " rejected oversized binary message");
+      return false;
+    }
+    std::string payload(length, '\0');
+    if (length > 0 && !socket.recv(length, &payload[0]))
+      return false;
+    msg = Message::fromBinary(header, payload.data());
+    return true;
+  }
+  //----< writes the file that follows a file message to disk >-----
+  /*
+  *  - bytes go from the socket to the file without being copied into
+  *    this process
+  *  - enQs a progress message after each chunk
+  *  - on success msg.file() becomes the saved path
+  */
+  bool receiveFile(Socket& socket, Message& msg)
+  {
+    size_t size = Utilities::Converter<size_t>::toValue(msg.attribute(FileSizeKey));
+    std::string path = fileDirectory_ + "/" + baseName(msg.file());
+    int fileDescriptor = openFile(path, true);
+    if (fileDescriptor == -1)
+    {
+      StaticLogger<1>::write("\n  -- " + clientHandlerName + " can't create " + path);
+      return false;
+    }
+    size_t received = 0;
+    while (received < size)
+    {
+      size_t chunk = (std::min)(size - received, FileProgressChunk);
+      if (!socket.recvFile(fileDescriptor, received, chunk))
+        break;
+      received += chunk;
 
+      pQ_->enQ(fileProgressMessage(msg, path, received, size));
+    }
+    closeFile(fileDescriptor);
+    if (received < size)
+    {
+      StaticLogger<1>::write("\n  -- " + clientHandlerName + " lost connection receiving " + path);
+      std::remove(path.c_str());
+      return false;
+    }
+    msg.file(path);
+    return true;
+  }
+  //----< reads messages from socket and enQs in rcvQ >--------------
+  /*
+  *  - a binary preamble as the first line selects binary framing,
+  *    otherwise that line is the first attribute of a text message
+  */
   void operator()(Socket socket)
   {
+    std::string firstLine = socket.recvString('\n');
+    bool binary = (firstLine == BinaryPreamble);
+    if (binary)
+      firstLine.clear();
     while (socket.validState())
     {
-      std::string msgString = readMsg(socket);
-      if (msgString.length() == 0)
+      Message msg;
+      if (binary)
       {
-        // invalid message
-        break;
+        if (!readBinaryMsg(socket, msg))
+          break;
+      }
+      else
+      {
+        std::string msgString = readMsg(socket, firstLine);
+        firstLine.clear();
+        if (msgString.length() == 0)
+        {
+          // invalid message
+          break;
+        }
+        msg = Message::fromString(msgString);
       }
-      Message msg = Message::fromString(msgString);
       StaticLogger<1>::write("\n  -- " + clientHandlerName + " RecvThread read message: " + msg.name());
+      if (msg.containsKey(FileSizeKey) && !receiveFile(socket, msg))
+        break;
       //std::cout << "\n  -- " + clientHandlerName + " RecvThread read message: " + msg.name();
       pQ_->enQ(msg);
       //std::cout << "\n  -- message enqueued in rcvQ";
@@ -202,16 +641,464 @@ public:
     StaticLogger<1>::write("\n  -- terminating ClientHandler thread");
   }
 private:
+  static const size_t MaxBinaryPayload = 1024 * 1024 * 1024;
   BlockingQueue<Message>* pQ_;
   std::string clientHandlerName;
+  std::string fileDirectory_;
 };
 
+#ifndef _WIN32
+/////////////////////////////////////////////////////////////////////
+// EventReceiver - epoll reactor used by Comm on POSIX
+
+namespace
+{
+  // bytes read from a connection per readiness event
+  const size_t ScratchSize = 64 * 1024;
+  // file bytes spliced from one connection per readiness event, so a
+  //  large transfer can't starve the other connections of its thread
+  const size_t SpliceBudget = 1024 * 1024;
+  // connections accepted per readiness event of the listener
+  const int AcceptBatch = 64;
+  const size_t MaxFrame = 1024 * 1024 * 1024;
+
+  bool wouldBlock()
+  {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+}
+
+//----< state of one accepted connection >---------------------------
+
+struct EventReceiver::Connection
+{
+  enum class Framing { unknown, text, binary };
+
+  Connection(::SOCKET sock) : socket(sock) {}
+  ~Connection()
+  {
+    if (fileDescriptor != -1)
+    {
+      closeFile(fileDescriptor);
+      std::remove(filePath.c_str());
+    }
+  }
+
+  Socket socket;
+  Framing framing = Framing::unknown;
+  std::string pending;   // bytes of a frame that hasn't fully arrived
+  std::string textMsg;   // attribute lines of a text Message so far
+
+  // file that follows fileMsg, while one is arriving
+  int fileDescriptor = -1;
+  Message fileMsg;
+  std::string filePath;
+  size_t fileSize = 0;
+  size_t fileReceived = 0;
+};
+
+//----< state owned by one I/O thread >------------------------------
+
+struct EventReceiver::IoThread
+{
+  ~IoThread()
+  {
+    connections.clear();
+    if (epoll != -1)
+      ::close(epoll);
+    if (pipeFds[0] != -1)
+    {
+      ::close(pipeFds[0]);
+      ::close(pipeFds[1]);
+    }
+  }
+
+  int epoll = -1;
+  int pipeFds[2] = { -1, -1 };  // carries spliced file bytes
+  char scratch[ScratchSize];
+  std::unordered_map<int, std::unique_ptr<Connection>> connections;
+  std::thread thread;
+};
+
+//----< constructor sets port >--------------------------------------
+
+EventReceiver::EventReceiver(EndPoint ep, const std::string& name)
+  : listener(ep.port), rcvrName(name)
+{
+  ioThreads_ = (std::max)(1u, (std::min)(4u, std::thread::hardware_concurrency()));
+  StaticLogger<1>::write("\n  -- starting EventReceiver");
+}
+//----< destructor stops the I/O threads >---------------------------
+
+EventReceiver::~EventReceiver()
+{
+  stop();
+}
+//----< returns reference to receive queue >-------------------------
+
+BlockingQueue<Message>* EventReceiver::queue()
+{
+  return &rcvQ;
+}
+//----< retrieves received message >---------------------------------
+
+Message EventReceiver::getMessage()
+{
+  StaticLogger<1>::write("\n  -- " + rcvrName + " deQing message");
+  return rcvQ.deQ();
+}
+//----< get and set number of I/O threads >--------------------------
+/*
+*  - set before start()
+*/
+size_t EventReceiver::ioThreads()
+{
+  return ioThreads_;
+}
+
+void EventReceiver::ioThreads(size_t count)
+{
+  ioThreads_ = (std::max)(count, (size_t)1);
+}
+//----< number of open connections >---------------------------------
+
+size_t EventReceiver::connectionCount()
+{
+  return connections_;
+}
+//----< listens and starts the I/O threads >-------------------------
+/*
+*  - every I/O thread waits on the listener; EPOLLEXCLUSIVE wakes one
+*    of them per connection, which then owns it
+*  - a stop event, left readable, wakes all of them
+*/
+bool EventReceiver::start(const std::string& fileDirectory)
+{
+  fileDirectory_ = fileDirectory;
+  if (!listener.open())
+    return false;
+  stopEvent_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (stopEvent_ == -1)
+    return false;
+
+  for (size_t i = 0; i < ioThreads_; ++i)
+  {
+    std::unique_ptr<IoThread> io(new IoThread);
+    io->epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (io->epoll == -1 || ::pipe2(io->pipeFds, O_CLOEXEC) == -1)
+      return false;
+    ::fcntl(io->pipeFds[1], F_SETPIPE_SZ, (int)SpliceBudget);
+
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = stopEvent_;
+    ::epoll_ctl(io->epoll, EPOLL_CTL_ADD, stopEvent_, &ev);
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = listener;
+    ::epoll_ctl(io->epoll, EPOLL_CTL_ADD, listener, &ev);
+
+    threads_.push_back(std::move(io));
+  }
+  for (auto& io : threads_)
+    io->thread = std::thread(&EventReceiver::run, this, std::ref(*io));
+  return true;
+}
+//----< stops the I/O threads and closes their connections >---------
+/*
+*  - Messages already received stay in the receive queue
+*/
+void EventReceiver::stop()
+{
+  if (stopEvent_ == -1)
+    return;
+  uint64_t one = 1;
+  if (::write(stopEvent_, &one, sizeof(one)) != sizeof(one))
+    StaticLogger<1>::write("\n  -- " + rcvrName + " can't signal I/O threads");
+  for (auto& io : threads_)
+  {
+    if (io->thread.joinable())
+      io->thread.join();
+  }
+  threads_.clear();
+  ::close(stopEvent_);
+  stopEvent_ = -1;
+  connections_ = 0;
+  listener.stop();
+}
+//----< event loop of one I/O thread >-------------------------------
+
+void EventReceiver::run(IoThread& io)
+{
+  StaticLogger<1>::write("\n  -- " + rcvrName + " I/O thread waiting for events");
+  epoll_event events[64];
+  while (true)
+  {
+    int count = ::epoll_wait(io.epoll, events, 64, -1);
+    if (count == -1 && errno != EINTR)
+      break;
+    for (int i = 0; i < count; ++i)
+    {
+      int fd = events[i].data.fd;
+      if (fd == stopEvent_)
+      {
+        StaticLogger<1>::write("\n  -- " + rcvrName + " I/O thread stopping");
+        return;
+      }
+      if (fd == (::SOCKET)listener)
+      {
+        acceptConnections(io);
+        continue;
+      }
+      auto conn = io.connections.find(fd);
+      if (conn != io.connections.end() && !readConnection(io, *conn->second))
+      {
+        // closing the socket also takes it out of the epoll set
+        io.connections.erase(conn);
+        --connections_;
+      }
+    }
+  }
+}
+//----< accepts waiting connections and adds them to this thread >---
+
+void EventReceiver::acceptConnections(IoThread& io)
+{
+  for (int i = 0; i < AcceptBatch; ++i)
+  {
+    ::SOCKET sock = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sock == INVALID_SOCKET)
+    {
+      if (!wouldBlock() && errno != ECONNABORTED)
+        StaticLogger<1>::write("\n  -- " + rcvrName + " accept failed with error: " + std::to_string(errno));
+      return;
+    }
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = sock;
+    std::unique_ptr<Connection> conn(new Connection(sock));
+    if (::epoll_ctl(io.epoll, EPOLL_CTL_ADD, sock, &ev) == -1)
+      continue;
+    io.connections[sock] = std::move(conn);
+    ++connections_;
+    StaticLogger<1>::write("\n  -- " + rcvrName + " accepted connection");
+  }
+}
+//----< reads what a connection has and frames it >------------------
+/*
+*  - returns false when the connection should be closed
+*  - reads into the thread's scratch buffer; only an incomplete frame
+*    is copied into the connection
+*/
+bool EventReceiver::readConnection(IoThread& io, Connection& conn)
+{
+  if (conn.fileDescriptor != -1 && conn.pending.empty())
+    return spliceFile(io, conn);
+
+  ssize_t bytesRecvd = ::recv(conn.socket, io.scratch, ScratchSize, 0);
+  if (bytesRecvd == 0)
+    return false;
+  if (bytesRecvd < 0)
+    return wouldBlock();
+
+  size_t used = 0;
+  if (conn.pending.empty())
+  {
+    bool ok = frame(conn, io.scratch, bytesRecvd, used);
+    conn.pending.assign(io.scratch + used, bytesRecvd - used);
+    return ok;
+  }
+  conn.pending.append(io.scratch, bytesRecvd);
+  bool ok = frame(conn, conn.pending.data(), conn.pending.size(), used);
+  conn.pending.erase(0, used);
+  return ok;
+}
+//----< extracts complete frames from data >-------------------------
+/*
+*  - used is set to the number of bytes consumed; the rest belong to a
+*    frame that hasn't fully arrived
+*/
+bool EventReceiver::frame(Connection& conn, const char* data, size_t size, size_t& used)
+{
+  used = 0;
+  while (true)
+  {
+    const char* p = data + used;
+    size_t available = size - used;
+
+    if (conn.fileDescriptor != -1)
+    {
+      size_t bytes = (std::min)(available, conn.fileSize - conn.fileReceived);
+      if (bytes > 0 && !writeFile(conn, p, bytes))
+        return false;
+      used += bytes;
+      if (conn.fileDescriptor != -1)
+        return true;
+      continue;
+    }
+
+    if (conn.framing == Connection::Framing::unknown)
+    {
+      // a binary preamble selects binary framing, otherwise the first
+      //  line is the first attribute of a text message
+      bool whole = available >= BinaryPreamble.size();
+      if (!whole && !std::memchr(p, '\n', available))
+        return true;
+      if (whole && std::memcmp(p, BinaryPreamble.data(), BinaryPreamble.size()) == 0)
+      {
+        conn.framing = Connection::Framing::binary;
+        used += BinaryPreamble.size();
+      }
+      else
+        conn.framing = Connection::Framing::text;
+      continue;
+    }
+
+    if (conn.framing == Connection::Framing::binary)
+    {
+      if (available < Message::BinaryHeaderSize)
+        return true;
+      size_t length = Message::binaryPayloadLength(p);
+      if (length > MaxFrame)
+      {
+        StaticLogger<1>::write("\n  -- " + rcvrName + " rejected oversized binary message");
+        return false;
+      }
+      if (available < Message::BinaryHeaderSize + length)
+      {
+        conn.pending.reserve(Message::BinaryHeaderSize + length);
+        return true;
+      }
+      Message msg = Message::fromBinary(p, p + Message::BinaryHeaderSize);
+      used += Message::BinaryHeaderSize + length;
+      if (!deliver(conn, msg))
+        return false;
+      continue;
+    }
+
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', available));
+    if (!newline)
+      return conn.textMsg.size() + available <= MaxFrame;
+    size_t lineLength = newline - p + 1;
+    conn.textMsg.append(p, lineLength);
+    used += lineLength;
+    if (lineLength < 2)  // if empty line we are done
+    {
+      Message msg = Message::fromString(conn.textMsg);
+      conn.textMsg.clear();
+      if (!deliver(conn, msg))
+        return false;
+    }
+  }
+}
+//----< enQs a complete message, or starts receiving its file >------
+/*
+*  - returns false if the connection should be closed
+*/
+bool EventReceiver::deliver(Connection& conn, Message& msg)
+{
+  StaticLogger<1>::write("\n  -- " + rcvrName + " framed message: " + msg.name());
+  if (!msg.containsKey(FileSizeKey))
+  {
+    rcvQ.enQ(msg);
+    return msg.command() != "quit";
+  }
+
+  std::string path = fileDirectory_ + "/" + baseName(msg.file());
+  conn.fileDescriptor = openFile(path, true);
+  if (conn.fileDescriptor == -1)
+  {
+    StaticLogger<1>::write("\n  -- " + rcvrName + " can't create " + path);
+    return false;
+  }
+  conn.fileMsg = msg;
+  conn.filePath = path;
+  conn.fileSize = Utilities::Converter<size_t>::toValue(msg.attribute(FileSizeKey));
+  conn.fileReceived = 0;
+  return writeFile(conn, nullptr, 0);
+}
+//----< writes file bytes that arrived with other frames >-----------
+/*
+*  - enQs the file message once the whole file is written
+*/
+bool EventReceiver::writeFile(Connection& conn, const char* data, size_t size)
+{
+  size_t before = conn.fileReceived;
+  while (size > 0)
+  {
+    ssize_t written = ::pwrite(conn.fileDescriptor, data, size, (off_t)conn.fileReceived);
+    if (written <= 0 && errno != EINTR)
+      return false;
+    if (written > 0)
+    {
+      data += written;
+      size -= written;
+      conn.fileReceived += written;
+    }
+  }
+  fileProgress(conn, before);
+  return true;
+}
+//----< moves file bytes from the socket to the file in the kernel >-
+
+bool EventReceiver::spliceFile(IoThread& io, Connection& conn)
+{
+  size_t budget = (std::min)(conn.fileSize - conn.fileReceived, SpliceBudget);
+  ssize_t inPipe = ::splice(conn.socket, nullptr, io.pipeFds[1], nullptr, budget, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (inPipe == 0)
+    return false;
+  if (inPipe < 0)
+    return wouldBlock();
+
+  size_t before = conn.fileReceived;
+  off_t position = (off_t)conn.fileReceived;
+  while (inPipe > 0)
+  {
+    ssize_t written = ::splice(io.pipeFds[0], nullptr, conn.fileDescriptor, &position, inPipe, SPLICE_F_MOVE);
+    if (written > 0)
+    {
+      inPipe -= written;
+      conn.fileReceived += written;
+    }
+    else if (written == 0 || errno != EINTR)
+    {
+      // whatever is left in the pipe would corrupt the next transfer
+      ::close(io.pipeFds[0]);
+      ::close(io.pipeFds[1]);
+      if (::pipe2(io.pipeFds, O_CLOEXEC) == 0)
+        ::fcntl(io.pipeFds[1], F_SETPIPE_SZ, (int)SpliceBudget);
+      return false;
+    }
+  }
+  fileProgress(conn, before);
+  return true;
+}
+//----< enQs progress for each chunk crossed, and the finished file >-
+
+void EventReceiver::fileProgress(Connection& conn, size_t before)
+{
+  size_t received = conn.fileReceived;
+  if (received > before && (received / FileProgressChunk > before / FileProgressChunk || received == conn.fileSize))
+    rcvQ.enQ(fileProgressMessage(conn.fileMsg, conn.filePath, received, conn.fileSize));
+  if (received < conn.fileSize)
+    return;
+  closeFile(conn.fileDescriptor);
+  conn.fileDescriptor = -1;
+  conn.fileMsg.file(conn.filePath);
+  rcvQ.enQ(conn.fileMsg);
+}
+#endif
+
 Comm::Comm(EndPoint ep, const std::string& name) : rcvr(ep, name), sndr(name), commName(name) {}
 
-void Comm::start()
+//----< starts receiving and sending; false if it can't listen >----
+
+bool Comm::start()
 {
+#ifdef _WIN32
   BlockingQueue<Message>* pQ = rcvr.queue();
-  ClientHandler* pCh = new ClientHandler(pQ, commName);
+  ClientHandler* pCh = new ClientHandler(pQ, commName, fileDirectory_);
   /*
     There is a trivial memory leak here.  
     This ClientHandler is a prototype used to make ClientHandler copies for each connection.
@@ -221,8 +1108,14 @@ void Comm::start()
 
     I will clean this up in the next version.
   */
-  rcvr.start(*pCh);
+  if (!rcvr.start(*pCh))
+    return false;
+#else
+  if (!rcvr.start(fileDirectory_))
+    return false;
+#endif
   sndr.start();
+  return true;
 }
 
 void Comm::stop()
@@ -246,6 +1139,29 @@ std::string Comm::name()
   return commName;
 }
 
+WireFormat Comm::wireFormat()
+{
+  return sndr.wireFormat();
+}
+
+void Comm::wireFormat(WireFormat wf)
+{
+  sndr.wireFormat(wf);
+}
+//----< get and set where received files are saved >-----------------
+/*
+*  - set before start()
+*/
+std::string Comm::fileDirectory()
+{
+  return fileDirectory_;
+}
+
+void Comm::fileDirectory(const std::string& dir)
+{
+  fileDirectory_ = dir;
+}
+
 //----< test stub >--------------------------------------------------
 
 #ifdef TEST_COMM
@@ -825,3 +1741,406 @@ int main_Comm()
   return 0;
 }
 #endif
+
+//----< benchmark stub >---------------------------------------------
+
+#ifdef BENCH_COMM
+
+#include <chrono>
+#include <iomanip>
+
+/////////////////////////////////////////////////////////////////////
+// Counts recv-side system calls needed to frame Messages with
+// ClientHandler, the same path Comm's receiver uses, in either
+// wire format.
+//
+// Run with argument "file [MB]" to time a file transfer over loopback
+// instead, 2048 MB by default.
+//
+// Run with argument "pool [count]" to send count Messages alternating
+// between two Receivers, waiting for each to arrive, with and without
+// the Sender's connection pool.
+//
+// Run with argument "batch [count]" to post count Messages at once,
+// alternating between two Receivers, then wait for all of them, with
+// and without Sender batching.
+//
+// Run with argument "connections [max]" to hold up to max connections,
+// 10000 by default, open to a thread-per-connection Receiver and to an
+// EventReceiver.  A child process opens them and sends a Message on
+// each, then another round on request.  Reports the receiving process's
+// threads and memory, and the time to frame each round.
+
+class CountingHandler
+{
+public:
+  CountingHandler(BlockingQueue<size_t>* pResults, size_t msgCount)
+    : pResults_(pResults), msgCount_(msgCount) {}
+
+  void operator()(Socket socket)
+  {
+    ClientHandler ch(nullptr, "bench");
+    std::string firstLine = socket.recvString('\n');
+    bool binary = (firstLine == BinaryPreamble);
+    if (binary)
+      firstLine.clear();
+    size_t bytes = 0;
+    for (size_t i = 0; i < msgCount_; ++i)
+    {
+      Message msg;
+      if (binary)
+      {
+        if (!ch.readBinaryMsg(socket, msg))
+          break;
+        continue;
+      }
+      std::string msgString = ch.readMsg(socket, firstLine);
+      firstLine.clear();
+      if (msgString.length() == 0)
+        break;
+      bytes += msgString.length();
+      msg = Message::fromString(msgString);
+    }
+    pResults_->enQ(socket.recvSyscallCount());
+    pResults_->enQ(bytes);
+  }
+private:
+  BlockingQueue<size_t>* pResults_;
+  size_t msgCount_;
+};
+
+void fileBench(size_t megabytes)
+{
+  const std::string source = "CommFileBench.dat";
+  const std::string directory = "CommFileBench";
+#ifdef _WIN32
+  ::_mkdir(directory.c_str());
+#else
+  ::mkdir(directory.c_str(), 0755);
+#endif
+  {
+    std::vector<char> block(1024 * 1024);
+    for (size_t i = 0; i < block.size(); ++i)
+      block[i] = (char)(i * 31);
+    FILE* out = std::fopen(source.c_str(), "wb");
+    for (size_t i = 0; i < megabytes; ++i)
+      std::fwrite(block.data(), 1, block.size(), out);
+    std::fclose(out);
+  }
+
+  SocketSystem ss;
+  Comm receiver(EndPoint("localhost", 9073), "fileReceiver");
+  receiver.fileDirectory(directory);
+  receiver.start();
+  Sender sender("fileSender");
+  sender.start();
+
+  Message msg(EndPoint("localhost", 9073), EndPoint("localhost", 9074));
+  msg.name("file");
+  msg.file(source);
+  auto start = std::chrono::steady_clock::now();
+  sender.postMessage(msg);
+  size_t progressMsgs = 0;
+  Message reply;
+  while ((reply = receiver.getMessage()).name() == "file-progress")
+    ++progressMsgs;
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  sender.stop();
+  receiver.stop();
+
+  std::cout << "\n  file transfer over loopback";
+  std::cout << "\n  sent " << megabytes << " MB in " << secs << " sec, " << megabytes / secs << " MB/sec";
+  std::cout << "\n  progress Messages: " << progressMsgs;
+  std::cout << "\n  saved as " << reply.file() << "\n\n";
+  std::remove(reply.file().c_str());
+  std::remove(source.c_str());
+}
+
+void poolBench(size_t msgCount)
+{
+  SocketSystem ss;
+  Comm receiver1(EndPoint("localhost", 9075), "receiver1");
+  Comm receiver2(EndPoint("localhost", 9076), "receiver2");
+  receiver1.start();
+  receiver2.start();
+  Comm* receivers[] = { &receiver1, &receiver2 };
+
+  std::cout << "\n  " << msgCount << " Messages alternating between two Receivers";
+  std::cout << "\n  -----------------------------------------------------";
+  for (size_t maxConnections : { (size_t)1, (size_t)16 })
+  {
+    Sender sender("poolSender");
+    sender.maxConnections(maxConnections);
+    sender.start();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < msgCount; ++i)
+    {
+      Message msg(EndPoint("localhost", 9075 + i % 2), EndPoint("localhost", 9077));
+      msg.name("runtest");
+      msg.body(std::to_string(i));
+      sender.postMessage(msg);
+      receivers[i % 2]->getMessage();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t connects = sender.connectCount();
+    sender.stop();
+
+    std::cout << "\n  pool of " << maxConnections << (maxConnections == 1 ? "  (reconnects on each switch)" : " (keeps both connections)");
+    std::cout << "\n    connects: " << connects << ", " << secs * 1e6 / msgCount << " us per Message";
+  }
+  std::cout << "\n\n";
+  receiver1.stop();
+  receiver2.stop();
+}
+
+void batchBench(size_t msgCount)
+{
+  SocketSystem ss;
+  Comm receiver1(EndPoint("localhost", 9078), "receiver1");
+  Comm receiver2(EndPoint("localhost", 9079), "receiver2");
+  receiver1.start();
+  receiver2.start();
+
+  std::cout << "\n  burst of " << msgCount << " Messages alternating between two Receivers";
+  std::cout << "\n  ------------------------------------------------------------";
+  struct Setting { size_t batchSize; std::chrono::microseconds deadline; };
+  Setting settings[] = {
+    { 1, std::chrono::microseconds(0) },
+    { 64, std::chrono::microseconds(0) },
+    { 64, std::chrono::microseconds(50) }
+  };
+  for (Setting setting : settings)
+  {
+    Sender sender("batchSender");
+    sender.batchSize(setting.batchSize);
+    sender.flushDeadline(setting.deadline);
+    sender.start();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < msgCount; ++i)
+    {
+      Message msg(EndPoint("localhost", 9078 + i % 2), EndPoint("localhost", 9080));
+      msg.name("runtest");
+      msg.body(std::to_string(i));
+      sender.postMessage(msg);
+    }
+    for (size_t i = 0; i < msgCount; ++i)
+      (i % 2 ? receiver2 : receiver1).getMessage();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sender.stop();
+
+    std::cout << "\n  batch size " << std::setw(2) << setting.batchSize
+      << ", flush deadline " << std::setw(2) << setting.deadline.count() << " us";
+    std::cout << "\n    writes: " << sender.writeCount() << ", " << std::setprecision(3)
+      << sender.averageBatchSize() << " Messages per write, "
+      << secs * 1e6 / msgCount << " us per Message";
+  }
+  std::cout << "\n\n";
+  receiver1.stop();
+  receiver2.stop();
+}
+
+#ifndef _WIN32
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+
+// reads a "Name:  value" line of /proc/self/status
+size_t procStatus(const std::string& name)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, name.size(), name) == 0)
+      return Utilities::Converter<size_t>::toValue(line.substr(name.size() + 1));
+  }
+  return 0;
+}
+
+// child: opens count connections, sends msgStr on each, waits for a byte
+//  on goFd, sends again, and exits when goFd closes
+void connectionClient(int port, size_t count, const std::string& msgStr, int goFd)
+{
+  std::vector<int> socks(count);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::string first = BinaryPreamble + msgStr;
+  for (size_t i = 0; i < count; ++i)
+  {
+    socks[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(socks[i], (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+      ::close(socks[i]);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      socks[i] = ::socket(AF_INET, SOCK_STREAM, 0);
+    }
+    if (::write(socks[i], first.data(), first.size()) != (ssize_t)first.size())
+      std::_Exit(1);
+  }
+  char go;
+  if (::read(goFd, &go, 1) != 1)
+    std::_Exit(1);
+  for (size_t i = 0; i < count; ++i)
+    if (::write(socks[i], msgStr.data(), msgStr.size()) != (ssize_t)msgStr.size())
+      std::_Exit(1);
+  while (::read(goFd, &go, 1) > 0);
+  std::_Exit(0);
+}
+
+void startReceiver(Receiver& receiver, ClientHandler& handler)
+{
+  receiver.start(handler);
+}
+
+void startReceiver(EventReceiver& receiver, ClientHandler&)
+{
+  receiver.start();
+}
+
+// holds count connections open to one kind of receiver and prints a row
+template<typename ReceiverType>
+void connectionRound(const std::string& kind, size_t count, const std::string& msgStr)
+{
+  const int port = 9078;
+  int goPipe[2];
+  if (::pipe(goPipe) != 0)
+    return;
+  // fork before the receiver starts any threads
+  pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    ::close(goPipe[1]);
+    connectionClient(port, count, msgStr, goPipe[0]);
+  }
+  ::close(goPipe[0]);
+
+  ReceiverType receiver(EndPoint("localhost", port), "connections");
+  BlockingQueue<Message>* pQ = receiver.queue();
+  ClientHandler handler(pQ, "connections");
+  auto start = std::chrono::steady_clock::now();
+  startReceiver(receiver, handler);
+  for (size_t i = 0; i < count; ++i)
+    pQ->deQ();
+  double setup = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t threads = procStatus("Threads:");
+  size_t rssKB = procStatus("VmRSS:");
+
+  start = std::chrono::steady_clock::now();
+  if (::write(goPipe[1], "g", 1) != 1)
+    return;
+  for (size_t i = 0; i < count; ++i)
+    pQ->deQ();
+  double round = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  ::close(goPipe[1]);
+  ::waitpid(pid, nullptr, 0);
+  receiver.stop();
+
+  std::cout << "\n  " << std::left << std::setw(12) << count << std::setw(16) << kind
+    << std::setw(10) << threads << std::setw(11) << (size_t)(setup * 1000)
+    << std::setw(11) << round * 1000 << std::setw(10) << round * 1e6 / count
+    << rssKB / 1024 << std::right;
+}
+
+void connectionsBench(size_t maxConnections)
+{
+  rlimit files;
+  ::getrlimit(RLIMIT_NOFILE, &files);
+  files.rlim_cur = files.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &files);
+
+  Message msg(EndPoint("localhost", 9194), EndPoint("localhost", 9192));
+  msg.name("runtest");
+  msg.body("42");
+  std::string msgStr = msg.toBinary();
+
+  SocketSystem ss;
+  std::cout << "\n  open connections, each sending one Message per round";
+  std::cout << "\n  ----------------------------------------------------------------------------";
+  std::cout << "\n  connections receiver        threads   setup ms   round ms   us/msg    RSS MB";
+  for (size_t n : { 100, 1000, 5000, 10000 })
+  {
+    if (n > maxConnections)
+      break;
+    // Receiver holds a duplicate descriptor for each connection
+    if (2 * n + 64 <= files.rlim_cur)
+      connectionRound<Receiver>("thread each", n, msgStr);
+    else
+      std::cout << "\n  " << std::left << std::setw(12) << n << std::setw(16) << "thread each"
+        << "skipped, needs " << 2 * n << " descriptors" << std::right;
+    connectionRound<EventReceiver>("EventReceiver", n, msgStr);
+  }
+  std::cout << "\n\n";
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifndef _WIN32
+  if (argc > 1 && std::string(argv[1]) == "connections")
+  {
+    connectionsBench(argc > 2 ? Utilities::Converter<size_t>::toValue(argv[2]) : 10000);
+    return 0;
+  }
+#endif
+  if (argc > 1 && std::string(argv[1]) == "pool")
+  {
+    poolBench(argc > 2 ? Utilities::Converter<size_t>::toValue(argv[2]) : 10000);
+    return 0;
+  }
+  if (argc > 1 && std::string(argv[1]) == "batch")
+  {
+    batchBench(argc > 2 ? Utilities::Converter<size_t>::toValue(argv[2]) : 100000);
+    return 0;
+  }
+  if (argc > 1 && std::string(argv[1]) == "file")
+  {
+    fileBench(argc > 2 ? Utilities::Converter<size_t>::toValue(argv[2]) : 2048);
+    return 0;
+  }
+  size_t MsgCount = 100000;
+  if (argc > 1)
+    MsgCount = Utilities::Converter<size_t>::toValue(argv[1]);
+  bool binary = (argc > 2 && std::string(argv[2]) == "binary");
+
+  SocketSystem ss;
+  BlockingQueue<size_t> results;
+  SocketListener listener(9072);
+  CountingHandler handler(&results, MsgCount);
+  listener.start(handler);
+
+  SocketConnecter connecter;
+  while (!connecter.connect("localhost", 9072))
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  Message msg(EndPoint("localhost", 9194), EndPoint("localhost", 9192));
+  msg.name("runtest");
+  msg.body("42");
+  std::string msgStr = binary ? msg.toBinary() : msg.toString();
+  if (binary)
+    connecter.send(BinaryPreamble.length(), (Socket::byte*)BinaryPreamble.c_str());
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < MsgCount; ++i)
+    connecter.send(msgStr.length(), (Socket::byte*)msgStr.c_str());
+  size_t syscalls = results.deQ();
+  size_t bytes = results.deQ();
+  auto stop = std::chrono::steady_clock::now();
+  listener.stop();
+
+  double secs = std::chrono::duration<double>(stop - start).count();
+  if (binary)
+    bytes = MsgCount * msgStr.length();
+  std::cout << "\n  " << (binary ? "binary" : "text") << " framing";
+  std::cout << "\n  received " << MsgCount << " Messages, " << bytes << " bytes, in " << secs << " sec";
+  std::cout << "\n  recv-side syscalls        : " << syscalls;
+  std::cout << "\n  syscalls per Message      : " << double(syscalls) / MsgCount;
+  std::cout << "\n  one-byte recv would need  : " << double(bytes) / MsgCount << " per Message";
+  std::cout << "\n  Messages per second       : " << MsgCount / secs << "\n\n";
+  return 0;
+}
+
+#endif
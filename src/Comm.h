@@ -1,19 +1,39 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////
 // Comm.h - message-passing communication facility                 //
-// ver 1.0                                                         //
+// ver 1.8                                                         //
 // Jim Fawcett, CSE687-OnLine Object Oriented Design, Fall 2017    //
 /////////////////////////////////////////////////////////////////////
 /*
 *  Package Operations:
 *  -------------------
 *  This package defines Sender and Receiver classes.
-*  - Sender uses a SocketConnecter and supports connecting to multiple
-*    sequential endpoints and posting messages.
+*  - Sender keeps a pool of SocketConnecters, one per endpoint, so
+*    messages alternating between endpoints reuse open connections.
+*    Connections idle longer than idleTimeout are closed, and a full
+*    pool closes its least recently used connection.
+*  - Sender's send thread drains everything queued, up to batchSize
+*    Messages, and writes the Messages bound for each endpoint with one
+*    gathering send.  A non-zero flushDeadline lets it wait that long for
+*    a batch to fill.  averageBatchSize reports Messages per write.
+*  - Sender frames messages in binary by default.  It announces the format
+*    with a preamble line when it connects, so each connection is framed
+*    independently and text framing can still be chosen for debugging.
 *  - Receiver uses a SocketListener which returns a Socket on connection.
+*    Its ClientHandler reads the preamble, if any, to pick the framing.
+*  - EventReceiver, POSIX only, serves every connection from a few I/O
+*    threads waiting on epoll, instead of a thread per connection.  It
+*    frames Messages incrementally as bytes arrive.  Comm uses it where
+*    it is available.
+*  - A posted Message whose file() names a local file is followed on the
+*    wire by that file's bytes.  The receiving Comm writes them into its
+*    fileDirectory, enQing a "file-progress" Message for every chunk and
+*    then the Message itself, with file() changed to the saved path.
 *  It also defines a Comm class
 *  - Comm simply composes a Sender and a Receiver, exposing methods:
 *    postMessage(Message) and getMessage()
+*  - Comm::start returns false if the Receiver can't listen, e.g. when
+*    its port is already bound; nothing is started then
 *
 *  Required Files:
 *  ---------------
@@ -24,6 +44,28 @@
 *
 *  Maintenance History:
 *  --------------------
+*  ver 1.8 : 17 Oct 2026
+*  - Comm::start and Receiver::start report whether listening started
+*  ver 1.7 : 17 Oct 2026
+*  - Sender batches queued messages and coalesces the writes to each
+*    endpoint
+*  - added batching benchmark, "batch" in BENCH_COMM
+*  ver 1.6 : 17 Oct 2026
+*  - added EventReceiver and made it Comm's receiver on POSIX
+*  - added connection-scaling benchmark, "connections" in BENCH_COMM
+*  ver 1.5 : 17 Oct 2026
+*  - Sender pools connections by endpoint instead of reconnecting each
+*    time the destination changes
+*  ver 1.4 : 17 Oct 2026
+*  - implemented file transfer with Socket::sendFile and recvFile, so file
+*    bytes never pass through a Message body
+*  ver 1.3 : 17 Oct 2026
+*  - Sender retries the connection on the next message after a failed
+*    connect, instead of writing to the unconnected socket
+*  ver 1.2 : 17 Oct 2026
+*  - added binary framing, selected with Sender::wireFormat
+*  ver 1.1 : 17 Oct 2026
+*  - added syscalls-per-Message benchmark, compiled with BENCH_COMM
 *  ver 1.0 : 03 Oct 2017
 *  - first release
 */
@@ -33,6 +75,11 @@
 #include "Sockets.h"
 #include <string>
 #include <thread>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <atomic>
 
 using namespace Sockets;
 
@@ -46,7 +93,7 @@ namespace MsgPassingCommunication
   public:
     Receiver(EndPoint ep, const std::string& name = "Receiver");
     template<typename CallableObject>
-    void start(CallableObject& co);
+    bool start(CallableObject& co);
     void stop();
     Message getMessage();
     BlockingQueue<Message>* queue();
@@ -58,6 +105,50 @@ namespace MsgPassingCommunication
 
   //BlockingQueue<Message> Receiver::rcvQ;
 
+#ifndef _WIN32
+  ///////////////////////////////////////////////////////////////////
+  // EventReceiver class
+  // - accepts and reads every connection on a fixed set of I/O threads,
+  //   each waiting on its own epoll instance
+  // - bytes are framed as they arrive; only a partial frame is kept
+  //   per connection, complete Messages go to the receive queue
+  // - files that follow a file Message are spliced to disk, as with
+  //   Receiver's ClientHandler
+
+  class EventReceiver
+  {
+  public:
+    EventReceiver(EndPoint ep, const std::string& name = "EventReceiver");
+    ~EventReceiver();
+    bool start(const std::string& fileDirectory = ".");
+    void stop();
+    Message getMessage();
+    BlockingQueue<Message>* queue();
+    size_t ioThreads();
+    void ioThreads(size_t count);
+    size_t connectionCount();
+  private:
+    struct Connection;
+    struct IoThread;
+    void run(IoThread& io);
+    void acceptConnections(IoThread& io);
+    bool readConnection(IoThread& io, Connection& conn);
+    bool frame(Connection& conn, const char* data, size_t size, size_t& used);
+    bool deliver(Connection& conn, Message& msg);
+    bool writeFile(Connection& conn, const char* data, size_t size);
+    bool spliceFile(IoThread& io, Connection& conn);
+    void fileProgress(Connection& conn, size_t before);
+    BlockingQueue<Message> rcvQ;
+    SocketListener listener;
+    std::string rcvrName;
+    std::string fileDirectory_;
+    size_t ioThreads_;
+    std::vector<std::unique_ptr<IoThread>> threads_;
+    int stopEvent_ = -1;
+    std::atomic<size_t> connections_{ 0 };
+  };
+#endif
+
   ///////////////////////////////////////////////////////////////////
   // Sender class
 
@@ -70,27 +161,76 @@ namespace MsgPassingCommunication
     void stop();
     bool connect(EndPoint ep);
     void postMessage(Message msg);
-    bool sendFile(const std::string& fileName);
+    WireFormat wireFormat();
+    void wireFormat(WireFormat wf);
+    size_t maxConnections();
+    void maxConnections(size_t max);
+    std::chrono::milliseconds idleTimeout();
+    void idleTimeout(std::chrono::milliseconds timeout);
+    size_t connectCount();
+    size_t batchSize();
+    void batchSize(size_t size);
+    std::chrono::microseconds flushDeadline();
+    void flushDeadline(std::chrono::microseconds deadline);
+    size_t messageCount();
+    size_t writeCount();
+    double averageBatchSize();
   private:
+    struct Connection
+    {
+      std::unique_ptr<SocketConnecter> connecter;
+      std::chrono::steady_clock::time_point lastUsed;
+    };
+    struct Batch
+    {
+      EndPoint to;
+      std::vector<std::string> frames;
+    };
+    SocketConnecter* connection(const EndPoint& ep);
+    void dropConnection(const EndPoint& ep);
+    void evictIdle();
+    void collectBatch(std::vector<Message>& msgs);
+    bool sendBatch(std::vector<Message>& msgs);
+    void flush(std::vector<Batch>& batches);
+    bool sendFrames(const EndPoint& ep, const std::vector<std::string>& frames);
+    std::string frame(const Message& msg);
+    bool sendMessage(const Message& msg);
+    bool sendFile(Message& msg);
     BlockingQueue<Message> sndQ;
-    SocketConnecter connecter;
+    std::map<std::string, Connection> pool_;  // keyed by EndPoint::toString()
     std::thread sendThread;
-    EndPoint lastEP;
     std::string sndrName;
+    WireFormat wireFormat_ = WireFormat::binary;
+    size_t maxConnections_ = 16;
+    std::chrono::milliseconds idleTimeout_{ 30000 };
+    std::atomic<size_t> connects_{ 0 };
+    size_t batchSize_ = 64;
+    std::chrono::microseconds flushDeadline_{ 0 };
+    std::atomic<size_t> messages_{ 0 };
+    std::atomic<size_t> writes_{ 0 };
   };
 
   class Comm
   {
   public:
     Comm(EndPoint ep, const std::string& name = "Comm");
-    void start();
+    bool start();
     void stop();
     void postMessage(Message msg);
     Message getMessage();
     std::string name();
+    WireFormat wireFormat();
+    void wireFormat(WireFormat wf);
+    std::string fileDirectory();
+    void fileDirectory(const std::string& dir);
   private:
     Sender sndr;
+#ifdef _WIN32
     Receiver rcvr;
+#else
+    EventReceiver rcvr;
+#endif
     std::string commName;
+    std::string fileDirectory_ = ".";
   };
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 #define CPP11_BLOCKINGQUEUE_H
 ///////////////////////////////////////////////////////////////
 // Cpp11-BlockingQueue.h - Thread-safe Blocking Queue        //
-// ver 1.3                                                   //
+// ver 1.5                                                   //
 // Jim Fawcett, CSE687 - Object Oriented Design, Spring 2015 //
 ///////////////////////////////////////////////////////////////
 /*
@@ -22,8 +22,17 @@
  * --------------
  * devenv Cpp11-BlockingQueue.sln /rebuild debug
  *
+ * See Cpp11-LockFreeQueue.h for a bounded, lock-free queue with
+ * the same interface.
+ *
  * Maintenance History:
  * --------------------
+ * ver 1.5 : 17 Oct 2026
+ * - added deQAll, which takes everything queued under one lock, and a
+ *   tryDeQ that waits at most a given time
+ * ver 1.4 : 17 Oct 2026
+ * - added enQ(T&&) and made deQ() move the element out, so queued
+ *   Messages aren't deep-copied twice
  * ver 1.3 : 04 Mar 2016
  * - changed behavior of front() to throw exception
  *   on empty queue.
@@ -46,6 +55,8 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <chrono>
 
 template <typename T>
 class BlockingQueue {
@@ -56,7 +67,10 @@ public:
   BlockingQueue(const BlockingQueue<T>&) = delete;
   BlockingQueue<T>& operator=(const BlockingQueue<T>&) = delete;
   T deQ();
+  bool tryDeQ(T& t, std::chrono::microseconds timeout);
+  size_t deQAll(std::vector<T>& items, size_t max);
   void enQ(const T& t);
+  void enQ(T&& t);
   T& front();
   void clear();
   size_t size();
@@ -107,7 +121,7 @@ T BlockingQueue<T>::deQ()
    */
   if(q_.size() > 0)
   {
-    T temp = q_.front();
+    T temp = std::move(q_.front());
     q_.pop();
     return temp;
   }
@@ -115,10 +129,41 @@ T BlockingQueue<T>::deQ()
 
   while (q_.size() == 0)
     cv_.wait(l, [this] () { return q_.size() > 0; });
-  T temp = q_.front();
+  T temp = std::move(q_.front());
   q_.pop();
   return temp;
 }
+//----< remove front element, waiting at most timeout >----------------
+/*
+ * - returns false, leaving t alone, if nothing arrived in time
+ */
+template<typename T>
+bool BlockingQueue<T>::tryDeQ(T& t, std::chrono::microseconds timeout)
+{
+  std::unique_lock<std::mutex> l(mtx_);
+  if (!cv_.wait_for(l, timeout, [this]() { return q_.size() > 0; }))
+    return false;
+  t = std::move(q_.front());
+  q_.pop();
+  return true;
+}
+//----< move up to max elements to the back of items, without waiting >
+/*
+ * - returns the number moved
+ */
+template<typename T>
+size_t BlockingQueue<T>::deQAll(std::vector<T>& items, size_t max)
+{
+  std::lock_guard<std::mutex> l(mtx_);
+  size_t count = 0;
+  while (count < max && q_.size() > 0)
+  {
+    items.push_back(std::move(q_.front()));
+    q_.pop();
+    ++count;
+  }
+  return count;
+}
 //----< push element onto back of queue >------------------------------
 
 template<typename T>
@@ -130,6 +175,16 @@ void BlockingQueue<T>::enQ(const T& t)
   }
   cv_.notify_one();
 }
+
+template<typename T>
+void BlockingQueue<T>::enQ(T&& t)
+{
+  {
+    std::unique_lock<std::mutex> l(mtx_);
+    q_.push(std::move(t));
+  }
+  cv_.notify_one();
+}
 //----< peek at next item to be popped >-------------------------------
 
 template <typename T>
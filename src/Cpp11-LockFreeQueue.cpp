@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////
+// Cpp11-LockFreeQueue.cpp - Bounded lock-free blocking queue//
+// ver 1.0                                                   //
+///////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Cpp11-LockFreeQueue.h"
+
+#ifdef TEST_LOCKFREEQUEUE
+
+std::mutex ioLock;
+
+void test(LockFreeQueue<std::string>* pQ)
+{
+  std::string msg;
+  do
+  {
+    msg = pQ->deQ();
+    {
+      std::lock_guard<std::mutex> l(ioLock);
+      std::cout << "\n  thread deQed " << msg.c_str();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  } while (msg != "quit");
+}
+
+int main()
+{
+  std::cout << "\n  Demonstrating C++11 Lock-Free Queue";
+  std::cout << "\n =====================================";
+
+  LockFreeQueue<std::string> q(4);  // small, so enQ has to wait for room
+  std::thread t(test, &q);
+
+  for (int i = 0; i < 15; ++i)
+  {
+    std::ostringstream temp;
+    temp << i;
+    std::string msg = std::string("msg#") + temp.str();
+    {
+      std::lock_guard<std::mutex> l(ioLock);
+      std::cout << "\n   main enQing " << msg.c_str() << ", size = " << q.size();
+    }
+    q.enQ(msg);
+  }
+  q.enQ("quit");
+  t.join();
+
+  std::cout << "\n";
+  std::cout << "\n  Passing move-only elements";
+  std::cout << "\n ----------------------------";
+
+  LockFreeQueue<std::unique_ptr<std::string>> mq(8);
+  mq.enQ(std::unique_ptr<std::string>(new std::string("moved in and out")));
+  std::unique_ptr<std::string> p = mq.deQ();
+  std::cout << "\n  deQed " << *p;
+
+  std::unique_ptr<std::string> none;
+  std::cout << "\n  tryDeQ on empty queue returns " << std::boolalpha << mq.tryDeQ(none);
+  std::cout << "\n\n";
+}
+
+#endif
+
+#ifdef BENCH_LOCKFREEQUEUE
+
+#include <chrono>
+#include "Cpp11-BlockingQueue.h"
+
+/////////////////////////////////////////////////////////////////////
+// Contention benchmark
+// - n producers and n consumers pass the same total number of items
+//   through one queue, for n = 1 .. 64
+// - compares LockFreeQueue with the mutex based BlockingQueue
+
+template<typename Queue>
+double run(Queue& q, size_t threads, size_t total)
+{
+  size_t perThread = total / threads;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> sink(0);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&q, perThread]() {
+      for (size_t i = 0; i < perThread; ++i)
+        q.enQ(i);
+    });
+    workers.emplace_back([&q, &sink, perThread]() {
+      size_t sum = 0;
+      for (size_t i = 0; i < perThread; ++i)
+        sum += q.deQ();
+      sink += sum;
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+  auto stop = std::chrono::steady_clock::now();
+  return (perThread * threads) / std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+  size_t Total = 2000000;
+  if (argc > 1)
+    Total = std::stoul(argv[1]);
+
+  std::cout << "\n  Producer/consumer pairs passing " << Total << " items, ops per second";
+  std::cout << "\n  ---------------------------------------------------------------";
+  std::cout << "\n  pairs      BlockingQueue      LockFreeQueue    speedup";
+  for (size_t threads = 1; threads <= 64; threads *= 2)
+  {
+    BlockingQueue<size_t> bq;
+    LockFreeQueue<size_t> lfq(4096);
+    double bqOps = run(bq, threads, Total);
+    double lfqOps = run(lfq, threads, Total);
+    std::cout << "\n  " << threads << std::string(threads < 10 ? 10 : 9, ' ')
+      << (size_t)bqOps << std::string(19 - std::to_string((size_t)bqOps).size(), ' ')
+      << (size_t)lfqOps << std::string(17 - std::to_string((size_t)lfqOps).size(), ' ')
+      << lfqOps / bqOps;
+  }
+  std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef CPP11_LOCKFREEQUEUE_H
+#define CPP11_LOCKFREEQUEUE_H
+///////////////////////////////////////////////////////////////
+// Cpp11-LockFreeQueue.h - Bounded lock-free blocking queue  //
+// ver 1.0                                                   //
+///////////////////////////////////////////////////////////////
+/*
+ * Package Operations:
+ * -------------------
+ * This package contains one thread-safe class: LockFreeQueue<T>.
+ * It has the same enQ/deQ/size interface as BlockingQueue<T> but
+ * is a bounded multi-producer, multi-consumer ring buffer:
+ * - each slot carries a sequence number, so producers and consumers
+ *   claim slots with a single compare-and-swap and never take a lock
+ * - elements are moved in and out, so move-only types work
+ * - when the queue is full (enQ) or empty (deQ) a thread spins
+ *   briefly, then parks on a condition variable; the mutex is only
+ *   touched when some thread is actually parked
+ *
+ * Capacity is rounded up to a power of two.  enQ blocks when the
+ * queue is full, so size it for the largest expected backlog.
+ *
+ * Required Files:
+ * ---------------
+ * Cpp11-LockFreeQueue.h
+ *
+ * Build Process:
+ * --------------
+ * compile Cpp11-LockFreeQueue.cpp with TEST_LOCKFREEQUEUE for the
+ * test stub, or with BENCH_LOCKFREEQUEUE for the contention benchmark
+ *
+ * Maintenance History:
+ * --------------------
+ * ver 1.0 : 17 Oct 2026
+ * - first release
+ *
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+template <typename T>
+class LockFreeQueue {
+public:
+  explicit LockFreeQueue(size_t capacity = 1024);
+  ~LockFreeQueue();
+  LockFreeQueue(const LockFreeQueue<T>&) = delete;
+  LockFreeQueue<T>& operator=(const LockFreeQueue<T>&) = delete;
+  T deQ();
+  void enQ(const T& t);
+  void enQ(T&& t);
+  bool tryDeQ(T& t);
+  bool tryEnQ(T&& t);
+  void clear();
+  size_t size();
+  size_t capacity() const { return mask_ + 1; }
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    T* ptr() { return reinterpret_cast<T*>(&storage); }
+  };
+  static const size_t SpinCount = 64;
+  static void spin(size_t i);
+  Cell* claimEnQ();
+  Cell* claimDeQ();
+  void publishEnQ(Cell* cell);
+  void releaseDeQ(Cell* cell);
+  bool canEnQ();
+  bool canDeQ();
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> enqueuePos_;
+  alignas(64) std::atomic<size_t> dequeuePos_;
+  alignas(64) std::atomic<size_t> parkedProducers_;
+  std::atomic<size_t> parkedConsumers_;
+  std::mutex parkMtx_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+};
+//----< constructor, capacity is rounded up to a power of two >--------
+
+template<typename T>
+LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+  : enqueuePos_(0), dequeuePos_(0), parkedProducers_(0), parkedConsumers_(0)
+{
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  mask_ = size - 1;
+  cells_.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i)
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+//----< destructor destroys elements still in the queue >--------------
+
+template<typename T>
+LockFreeQueue<T>::~LockFreeQueue()
+{
+  clear();
+}
+//----< back off while waiting: pause briefly, then yield >------------
+
+template<typename T>
+void LockFreeQueue<T>::spin(size_t i)
+{
+  if (i >= SpinCount / 4)
+    std::this_thread::yield();
+}
+//----< claim a free slot at the tail, or nullptr if full >------------
+/*
+*  A slot is free for position pos when its sequence equals pos.
+*  A sequence behind pos means the consumer of the previous lap
+*  hasn't released it yet, i.e., the queue is full.
+*/
+template<typename T>
+typename LockFreeQueue<T>::Cell* LockFreeQueue<T>::claimEnQ()
+{
+  size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  while (true)
+  {
+    Cell* cell = &cells_[pos & mask_];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0)
+    {
+      if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        return cell;
+    }
+    else if (diff < 0)
+      return nullptr;
+    else
+      pos = enqueuePos_.load(std::memory_order_relaxed);
+  }
+}
+//----< claim a filled slot at the head, or nullptr if empty >---------
+/*
+*  A slot holds the element for position pos when its sequence
+*  equals pos + 1.
+*/
+template<typename T>
+typename LockFreeQueue<T>::Cell* LockFreeQueue<T>::claimDeQ()
+{
+  size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  while (true)
+  {
+    Cell* cell = &cells_[pos & mask_];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+    if (diff == 0)
+    {
+      if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        return cell;
+    }
+    else if (diff < 0)
+      return nullptr;
+    else
+      pos = dequeuePos_.load(std::memory_order_relaxed);
+  }
+}
+//----< mark filled slot readable, wake a parked consumer >------------
+/*
+*  The fence pairs with the increment of parkedConsumers_ in deQ:
+*  either the consumer sees the element before parking, or we see
+*  the consumer and notify it under the park mutex.
+*/
+template<typename T>
+void LockFreeQueue<T>::publishEnQ(Cell* cell)
+{
+  size_t pos = cell->sequence.load(std::memory_order_relaxed);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parkedConsumers_.load(std::memory_order_relaxed) > 0)
+  {
+    std::lock_guard<std::mutex> l(parkMtx_);
+    notEmpty_.notify_one();
+  }
+}
+//----< mark emptied slot free for the next lap, wake a producer >-----
+
+template<typename T>
+void LockFreeQueue<T>::releaseDeQ(Cell* cell)
+{
+  size_t pos = cell->sequence.load(std::memory_order_relaxed) - 1;
+  cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parkedProducers_.load(std::memory_order_relaxed) > 0)
+  {
+    std::lock_guard<std::mutex> l(parkMtx_);
+    notFull_.notify_one();
+  }
+}
+//----< would claimEnQ find a free slot now? >-------------------------
+
+template<typename T>
+bool LockFreeQueue<T>::canEnQ()
+{
+  size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+  return (intptr_t)seq - (intptr_t)pos >= 0;
+}
+//----< would claimDeQ find an element now? >--------------------------
+
+template<typename T>
+bool LockFreeQueue<T>::canDeQ()
+{
+  size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+  return (intptr_t)seq - (intptr_t)(pos + 1) >= 0;
+}
+//----< push element onto back of queue, if there is room >------------
+
+template<typename T>
+bool LockFreeQueue<T>::tryEnQ(T&& t)
+{
+  Cell* cell = claimEnQ();
+  if (!cell)
+    return false;
+  new (cell->ptr()) T(std::move(t));
+  publishEnQ(cell);
+  return true;
+}
+//----< remove element from front of queue, if there is one >----------
+
+template<typename T>
+bool LockFreeQueue<T>::tryDeQ(T& t)
+{
+  Cell* cell = claimDeQ();
+  if (!cell)
+    return false;
+  t = std::move(*cell->ptr());
+  cell->ptr()->~T();
+  releaseDeQ(cell);
+  return true;
+}
+//----< push element onto back of queue, blocking while full >---------
+
+template<typename T>
+void LockFreeQueue<T>::enQ(T&& t)
+{
+  for (size_t i = 0; ; ++i)
+  {
+    if (tryEnQ(std::move(t)))
+      return;
+    if (i < SpinCount)
+    {
+      spin(i);
+      continue;
+    }
+    std::unique_lock<std::mutex> l(parkMtx_);
+    parkedProducers_.fetch_add(1);
+    notFull_.wait(l, [this]() { return canEnQ(); });
+    parkedProducers_.fetch_sub(1);
+    i = 0;
+  }
+}
+
+template<typename T>
+void LockFreeQueue<T>::enQ(const T& t)
+{
+  T temp(t);
+  enQ(std::move(temp));
+}
+//----< remove element from front of queue, blocking while empty >-----
+
+template<typename T>
+T LockFreeQueue<T>::deQ()
+{
+  for (size_t i = 0; ; ++i)
+  {
+    Cell* cell = claimDeQ();
+    if (cell)
+    {
+      T temp(std::move(*cell->ptr()));
+      cell->ptr()->~T();
+      releaseDeQ(cell);
+      return temp;
+    }
+    if (i < SpinCount)
+    {
+      spin(i);
+      continue;
+    }
+    std::unique_lock<std::mutex> l(parkMtx_);
+    parkedConsumers_.fetch_add(1);
+    notEmpty_.wait(l, [this]() { return canDeQ(); });
+    parkedConsumers_.fetch_sub(1);
+    i = 0;
+  }
+}
+//----< remove all elements from queue >-------------------------------
+
+template <typename T>
+void LockFreeQueue<T>::clear()
+{
+  while (Cell* cell = claimDeQ())
+  {
+    cell->ptr()->~T();
+    releaseDeQ(cell);
+  }
+}
+//----< return number of elements in queue >---------------------------
+/*
+*  - a snapshot; other threads may change it before the caller looks
+*/
+template<typename T>
+size_t LockFreeQueue<T>::size()
+{
+  size_t deq = dequeuePos_.load(std::memory_order_acquire);
+  size_t enq = enqueuePos_.load(std::memory_order_acquire);
+  if (enq <= deq)
+    return 0;
+  return (enq - deq > mask_ + 1) ? mask_ + 1 : enq - deq;
+}
+
+#endif
@@ -2,13 +2,20 @@
 
 DetailedLogging::DetailedLogging() : Logging(LoggingLevel::DETAILED) {}
 
-void DetailedLogging::DisplayResult(TestResult& result)
+DetailedLogging::~DetailedLogging()
+{
+    Stop();
+}
+
+void DetailedLogging::FormatResult(const TestResult& result, string& out)
 {
     // Log test name
-    cout << result.getTestName() << endl;
+    out += result.getTestName();
+    out += '\n';
     // Log PASS/FAIL to console.
-    cout << SuccessValue(result.getIsSuccessful()) <<endl;
+    out += SuccessValue(result);
+    out += '\n';
     // Log test specific message to console.
-    cout << result.getMessage() << endl;
-    
+    out += result.getMessage();
+    out += '\n';
 }
\ No newline at end of file
@@ -2,8 +2,8 @@
     DetailedLogging.h
 
     This file contains the declaration and implementation of the DetailedLogging class.
-    Concrete class that derives from Logging abstract class. Logs PASS/FAIL results and 
-    test specific message to console.
+    Concrete class that derives from Logging abstract class. Formats PASS/FAIL results and 
+    test specific message for the console.
 
 */
 
@@ -13,11 +13,6 @@
 #include "TestResult.h"
 #include "Logging.h"
 
-#include <iostream>
-
-using std::cout;
-using std::endl;
-
 /**
 * Displays a Detailed test result
 **/
@@ -27,7 +22,13 @@ class DetailedLogging : public Logging
 public:
     DetailedLogging();
 
-    void DisplayResult(TestResult& result) override;
+    /**
+    * Writes the queued results before the formatter goes away
+    **/
+    ~DetailedLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
 };
 
 #endif /* DetailedLogging_h */
@@ -10,8 +10,40 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
 using std::string;
 
+/**
+* Shared flag a long running test can poll to find out that the harness
+* has given up on it. Copies share the same flag, so a test body can keep
+* its own copy of the token it was given.
+**/
+class CancellationToken
+{
+public:
+	CancellationToken() : cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+	/**
+	* Asks the test holding this token to stop
+	**/
+	void cancel() const { *cancelled = true; }
+
+	/**
+	* Returns true once the test should stop
+	**/
+	bool isCancelled() const { return *cancelled; }
+
+	/**
+	* Clears the flag before the test is run again
+	**/
+	void reset() const { *cancelled = false; }
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
 /**
 * Abstracion of a test used to return 
 **/
@@ -47,12 +79,60 @@ public:
 	**/
 	string getTestName() const { return testName; }
 
+	/**
+	* Returns the token the harness cancels when this test runs too long.
+	* Tests that can stop early should poll it; others simply run on.
+	**/
+	CancellationToken getCancellationToken() const { return token; }
+
+	/**
+	* Replaces the cancellation token, e.g. with one a lambda has captured
+	*
+	* @tkn[in] - token to be cancelled when this test times out
+	**/
+	void setCancellationToken(CancellationToken tkn) { token = tkn; }
+
+	/**
+	* Returns this test's time limit; zero means the harness default
+	**/
+	std::chrono::milliseconds getTimeout() const { return timeout; }
+
+	/**
+	* Sets a time limit for this test that overrides the harness default
+	*
+	* @limit[in] - time limit; zero means the harness default
+	**/
+	void setTimeout(std::chrono::milliseconds limit) { timeout = limit; }
+
+	/**
+	* Declares something this test's result depends on besides its code,
+	* e.g. a digest of a data file it reads. A cached result is reused
+	* only while the declared inputs are unchanged.
+	*
+	* @input[in] - value the result depends on
+	**/
+	void declareInput(const string& input) { inputs.push_back(input); }
+
+	/**
+	* Returns the inputs declared so far
+	**/
+	const std::vector<string>& getInputs() const { return inputs; }
+
 	/**
 	* Runs this test
 	* Virtual function to be overriden by derived classes.
 	**/
 	virtual bool run() = 0;
+
+	/**
+	* Returns measurements from the last run, if any, to be logged with
+	* the result. Called after run on the same thread
+	**/
+	virtual string getDetails() const { return ""; }
 private:
 	string errorMessage;
 	string testName;
+	CancellationToken token;
+	std::chrono::milliseconds timeout{ 0 };
+	std::vector<string> inputs;
 };
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "JUnitLogging.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+    // Appends text with XML markup characters escaped. Control characters
+    //  other than tab and newline aren't allowed in XML 1.0, so they're
+    //  replaced; newlines too, inside attributes.
+    void appendEscaped(string& out, const string& text, bool attribute)
+    {
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&apos;"; break;
+            case '\t': out += attribute ? "&#9;" : "\t"; break;
+            case '\n': out += attribute ? "&#10;" : "\n"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out += '?';
+                else
+                    out += c;
+            }
+        }
+    }
+}
+
+JUnitLogging::JUnitLogging(const string& path, const string& suiteName) :
+    Logging(LoggingLevel::VERY_DETAILED), file(path, std::ios::binary | std::ios::trunc), className(suiteName)
+{
+    if (!file)
+        throw std::runtime_error("JUnitLogging: can't create " + path);
+    string header = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuite name=\"";
+    appendEscaped(header, suiteName, true);
+    header += "\">\n";
+    file << header;
+    SetOutput(&file);
+}
+
+JUnitLogging::~JUnitLogging()
+{
+    // The logging thread uses file and className, so it's stopped first.
+    Stop();
+    file << "</testsuite>\n";
+}
+
+void JUnitLogging::FormatResult(const TestResult& result, string& out)
+{
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%.6f", result.getFunctionExecutionTime());
+    out += "  <testcase classname=\"";
+    appendEscaped(out, className, true);
+    out += "\" name=\"";
+    appendEscaped(out, result.getTestName(), true);
+    out += "\" time=\"";
+    out += seconds;
+    out += "\">\n";
+
+    const string message = result.getMessage();
+    if (!result.getIsSuccessful())
+    {
+        // The first line is the summary; the whole message is the body.
+        out += "    <failure message=\"";
+        appendEscaped(out, message.substr(0, message.find('\n')), true);
+        out += "\">";
+        appendEscaped(out, message, false);
+        out += "</failure>\n";
+    }
+    else if (result.getIsCached() || !message.empty())
+    {
+        out += "    <system-out>";
+        if (result.getIsCached())
+            out += "Result from cache\n";
+        appendEscaped(out, message, false);
+        out += "</system-out>\n";
+    }
+    out += "  </testcase>";
+}
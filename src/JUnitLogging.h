@@ -0,0 +1,50 @@
+/*
+    JUnitLogging.h
+
+    This file contains the declaration of the JUnitLogging class.
+    Concrete class that derives from Logging abstract class.
+    Streams results to a file as JUnit XML, for CI servers to read.
+
+    Each result is written as a testcase element as soon as it's logged,
+    so the document is never held in memory. The testsuite element is
+    closed when the logger is destroyed; it carries no counts, since
+    those aren't known until the end, and JUnit readers work them out
+    from the testcases.
+*/
+
+#ifndef JUnitLogging_h
+#define JUnitLogging_h
+
+#include "TestResult.h"
+#include "Logging.h"
+#include <fstream>
+
+/**
+* Writes test results to a JUnit XML file
+**/
+class JUnitLogging : public Logging
+{
+public:
+    /**
+    * Creates the file and writes the start of the document. Throws
+    * std::runtime_error if the file can't be created
+    *
+    * @path[in] - file to write, replaced if it exists
+    * @suiteName[in] - name of the testsuite, also used as each testcase's classname
+    **/
+    JUnitLogging(const string& path, const string& suiteName = "TestHarness");
+
+    /**
+    * Writes the queued results and closes the testsuite
+    **/
+    ~JUnitLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
+
+private:
+    std::ofstream file;
+    string className;
+};
+
+#endif /* JUnitLogging_h */
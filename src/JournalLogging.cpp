@@ -0,0 +1,123 @@
+#include "JournalLogging.h"
+#include "ResultJournal.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    // Returns the contents of a file, empty if it doesn't exist
+    std::vector<char> readFile(const string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    // Cuts off a partly written entry at the end of a file
+    void truncate(const string& path, size_t length)
+    {
+        std::error_code error;
+        std::filesystem::resize_file(path, length, error);
+        if (error)
+            throw std::runtime_error("JournalLogging: can't repair " + path);
+    }
+}
+
+JournalLogging::JournalLogging(const string& path) : Logging(LoggingLevel::VERY_DETAILED)
+{
+    // Read back the side table, so strings already in it keep their numbers.
+    const string stringsPath = path + ".strings";
+    std::vector<char> table = readFile(stringsPath);
+    size_t valid = 0;
+    if (!table.empty())
+    {
+        if (table.size() < sizeof(JournalStringsMagic) || memcmp(table.data(), JournalStringsMagic, sizeof(JournalStringsMagic)) != 0)
+            throw std::runtime_error("JournalLogging: " + stringsPath + " isn't a journal side table");
+        valid = sizeof(JournalStringsMagic);
+        while (table.size() - valid >= 4)
+        {
+            uint32_t length;
+            memcpy(&length, table.data() + valid, 4);
+            if (table.size() - valid - 4 < length)
+                break;
+            numbers.emplace(string(table.data() + valid + 4, length), static_cast<uint32_t>(numbers.size()));
+            valid += 4 + length;
+        }
+        if (valid != table.size())
+            truncate(stringsPath, valid);
+    }
+
+    std::vector<char> existing = readFile(path);
+    if (!existing.empty())
+    {
+        JournalHeader header;
+        if (existing.size() < sizeof(header))
+            throw std::runtime_error("JournalLogging: " + path + " isn't a journal");
+        memcpy(&header, existing.data(), sizeof(header));
+        if (memcmp(header.magic, JournalMagic, sizeof(JournalMagic)) != 0 ||
+            header.byteOrder != JournalByteOrder || header.recordSize != sizeof(JournalRecord))
+            throw std::runtime_error("JournalLogging: " + path + " isn't a journal written on this platform");
+        size_t records = (existing.size() - sizeof(header)) / sizeof(JournalRecord);
+        size_t length = sizeof(header) + records * sizeof(JournalRecord);
+        if (length != existing.size())
+            truncate(path, length);
+    }
+
+    strings.open(stringsPath, std::ios::binary | std::ios::app);
+    journal.open(path, std::ios::binary | std::ios::app);
+    if (!strings || !journal)
+        throw std::runtime_error("JournalLogging: can't open " + path);
+    if (valid == 0)
+        strings.write(JournalStringsMagic, sizeof(JournalStringsMagic));
+    if (existing.empty())
+    {
+        JournalHeader header;
+        memcpy(header.magic, JournalMagic, sizeof(JournalMagic));
+        header.byteOrder = JournalByteOrder;
+        header.recordSize = sizeof(JournalRecord);
+        journal.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    strings.flush();
+    journal.flush();
+    SetOutput(&journal, true);
+}
+
+JournalLogging::~JournalLogging()
+{
+    // The logging thread uses the files and the string numbers, so it's
+    //  stopped first.
+    Stop();
+}
+
+uint32_t JournalLogging::Intern(const string& text)
+{
+    auto found = numbers.find(text);
+    if (found != numbers.end())
+        return found->second;
+    uint32_t number = static_cast<uint32_t>(numbers.size());
+    uint32_t length = static_cast<uint32_t>(text.size());
+    strings.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    strings.write(text.data(), text.size());
+    strings.flush();
+    numbers.emplace(text, number);
+    return number;
+}
+
+void JournalLogging::FormatResult(const TestResult& result, string& out)
+{
+    const TestOutcome& outcome = result.getOutcome();
+    JournalRecord record;
+    record.name = Intern(result.getTestName());
+    record.message = Intern(result.getMessage());
+    record.flags = (outcome.successful ? JournalPassed : 0) | (outcome.cached ? JournalCached : 0);
+    record.reserved = 0;
+    record.start = result.getFunctionStartNanoseconds();
+    record.duration = 0;
+    if (outcome.startTicks != 0 && outcome.endTicks != 0)
+        record.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::duration(outcome.endTicks - outcome.startTicks)).count();
+    out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+}
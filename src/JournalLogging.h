@@ -0,0 +1,57 @@
+/*
+    JournalLogging.h
+
+    This file contains the declaration of the JournalLogging class.
+    Concrete class that derives from Logging abstract class.
+    Appends results to a binary result journal, for ResultJournal to map
+    and query after the run. See ResultJournal.h for the layout.
+
+    Test names and messages are written to the side table the first time
+    they're seen, and flushed straight away, so a record never reaches the
+    journal ahead of its strings.
+*/
+
+#ifndef JournalLogging_h
+#define JournalLogging_h
+
+#include "TestResult.h"
+#include "Logging.h"
+#include <fstream>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+* Appends test results to a result journal
+**/
+class JournalLogging : public Logging
+{
+public:
+    /**
+    * Opens a journal to append to, creating it if need be. A record or
+    * string cut short by an earlier crash is dropped. Throws
+    * std::runtime_error if the files can't be opened or aren't a journal
+    *
+    * @path[in] - journal file; the side table is path + ".strings"
+    **/
+    JournalLogging(const string& path);
+
+    /**
+    * Writes the queued results and closes the journal
+    **/
+    ~JournalLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
+
+private:
+    /**
+    * Returns the number of a string, adding it to the side table if new
+    **/
+    uint32_t Intern(const string& text);
+
+    std::ofstream journal;
+    std::ofstream strings;
+    std::unordered_map<string, uint32_t> numbers;
+};
+
+#endif /* JournalLogging_h */
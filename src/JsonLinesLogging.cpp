@@ -0,0 +1,80 @@
+#include "JsonLinesLogging.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+    // Appends text as a JSON string, quotes included. Bytes above 0x7f
+    //  are passed through, so UTF-8 text stays as it is.
+    void appendString(string& out, const string& text)
+    {
+        out += '"';
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                    out += escaped;
+                }
+                else
+                    out += c;
+            }
+        }
+        out += '"';
+    }
+
+    // Appends a timestamp, or null if it wasn't recorded
+    void appendTimestamp(string& out, const string& timestamp)
+    {
+        if (timestamp.empty())
+            out += "null";
+        else
+            appendString(out, timestamp);
+    }
+}
+
+JsonLinesLogging::JsonLinesLogging(const string& path, bool append) :
+    Logging(LoggingLevel::VERY_DETAILED),
+    file(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc))
+{
+    if (!file)
+        throw std::runtime_error("JsonLinesLogging: can't create " + path);
+    SetOutput(&file);
+}
+
+JsonLinesLogging::~JsonLinesLogging()
+{
+    // The logging thread writes to file, so it's stopped first.
+    Stop();
+}
+
+void JsonLinesLogging::FormatResult(const TestResult& result, string& out)
+{
+    // The logging thread ends each record with the newline.
+    out += "{\"name\":";
+    appendString(out, result.getTestName());
+    out += ",\"status\":";
+    out += result.getIsSuccessful() ? "\"PASS\"" : "\"FAIL\"";
+    out += ",\"cached\":";
+    out += result.getIsCached() ? "true" : "false";
+    out += ",\"message\":";
+    appendString(out, result.getMessage());
+    out += ",\"start\":";
+    appendTimestamp(out, result.getFunctionStartTimestamp());
+    out += ",\"end\":";
+    appendTimestamp(out, result.getFunctionEndTimestamp());
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%.6f", result.getFunctionExecutionTime());
+    out += ",\"seconds\":";
+    out += seconds;
+    out += '}';
+}
@@ -0,0 +1,46 @@
+/*
+    JsonLinesLogging.h
+
+    This file contains the declaration of the JsonLinesLogging class.
+    Concrete class that derives from Logging abstract class.
+    Streams results to a file as JSON Lines: one JSON object per result,
+    one result per line, written as soon as it's logged.
+
+    Each line holds name, status ("PASS" or "FAIL"), cached, message,
+    start and end (ISO 8601 UTC) and seconds.
+*/
+
+#ifndef JsonLinesLogging_h
+#define JsonLinesLogging_h
+
+#include "TestResult.h"
+#include "Logging.h"
+#include <fstream>
+
+/**
+* Writes test results to a JSON Lines file
+**/
+class JsonLinesLogging : public Logging
+{
+public:
+    /**
+    * Creates the file. Throws std::runtime_error if it can't be created
+    *
+    * @path[in] - file to write
+    * @append[in] - add to the end of an existing file instead of replacing it
+    **/
+    JsonLinesLogging(const string& path, bool append = false);
+
+    /**
+    * Writes the queued results and closes the file
+    **/
+    ~JsonLinesLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
+
+private:
+    std::ofstream file;
+};
+
+#endif /* JsonLinesLogging_h */
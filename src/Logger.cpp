@@ -12,7 +12,7 @@
 /////////////////////////////////////////////////////////////////////
 
 #include <functional>
-#include <Windows.h>
+#include <chrono>
 #include "Logger.h"
 #include "Utilities.h"
 
@@ -30,7 +30,7 @@ void Logger::flush()
   if (_ThreadRunning)
   {
     while (_queue.size() > 0)  // wait for logger queue to empty
-      ::Sleep(50);
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
     _pOut->flush();
   }
 }
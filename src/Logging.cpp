@@ -1,12 +1,425 @@
 #include "Logging.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
 
-Logging::Logging(LoggingLevel lvl) : logLevel(lvl) {}
+using std::vector;
 
-Logging::~Logging() { }
+namespace
+{
+    // Bytes in each thread's ring of records; a power of two
+    const size_t BufferCapacity = 64 * 1024;
+    // Longest record; text beyond it is truncated
+    const size_t MaxRecord = BufferCapacity / 4;
+    // Formatted text is written to the console in blocks about this size
+    const size_t BlockSize = 64 * 1024;
+
+    /**
+    * Fixed part of a record. The name and message follow it in the
+    * ring, without terminators
+    **/
+    struct RecordHeader
+    {
+        uint32_t size;
+        uint32_t lengths[2];
+        TestOutcome outcome;
+    };
+
+    std::atomic<unsigned long long> nextLoggingId(1);
+}
+
+/**
+* Ring of variable length records with one producer, the thread that
+* owns it, and one consumer, the logging thread. Positions only grow;
+* the ring index is the position modulo the capacity
+**/
+class LogBuffer
+{
+public:
+    LogBuffer() : retired(false), ring(BufferCapacity), head(0), tail(0) {}
+
+    /**
+    * Copies the result into the ring. Returns false if it is too full
+    **/
+    bool tryPush(const TestResult& result);
+
+    /**
+    * Moves the oldest record into result. Returns false if there is none
+    *
+    * @text[in] - scratch space for the record's text
+    **/
+    bool tryPop(TestResult& result, string& text);
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed); }
+
+    // set when the owning thread exits; the buffer is dropped once empty
+    std::atomic<bool> retired;
+
+private:
+    void copyIn(size_t pos, const char* src, size_t bytes);
+    void copyOut(size_t pos, char* dst, size_t bytes) const;
+
+    vector<char> ring;
+    // next position the producer writes
+    alignas(64) std::atomic<size_t> head;
+    // next position the consumer reads
+    alignas(64) std::atomic<size_t> tail;
+};
+
+void LogBuffer::copyIn(size_t pos, const char* src, size_t bytes)
+{
+    size_t offset = pos & (ring.size() - 1);
+    size_t first = std::min(bytes, ring.size() - offset);
+    std::memcpy(&ring[offset], src, first);
+    std::memcpy(&ring[0], src + first, bytes - first);
+}
+
+void LogBuffer::copyOut(size_t pos, char* dst, size_t bytes) const
+{
+    size_t offset = pos & (ring.size() - 1);
+    size_t first = std::min(bytes, ring.size() - offset);
+    std::memcpy(dst, &ring[offset], first);
+    std::memcpy(dst + first, &ring[0], bytes - first);
+}
+
+bool LogBuffer::tryPush(const TestResult& result)
+{
+    const string fields[2] = { result.getTestName(), result.getMessage() };
+
+    RecordHeader header;
+    header.outcome = result.getOutcome();
+    size_t room = MaxRecord - sizeof(header);
+    size_t size = sizeof(header);
+    for (int x = 0; x < 2; x++)
+    {
+        header.lengths[x] = (uint32_t)std::min(fields[x].size(), room);
+        room -= header.lengths[x];
+        size += header.lengths[x];
+    }
+    header.size = (uint32_t)size;
+
+    size_t pos = head.load(std::memory_order_relaxed);
+    if (ring.size() - (pos - tail.load(std::memory_order_acquire)) < size)
+        return false;
+    copyIn(pos, reinterpret_cast<const char*>(&header), sizeof(header));
+    pos += sizeof(header);
+    for (int x = 0; x < 2; x++)
+    {
+        copyIn(pos, fields[x].data(), header.lengths[x]);
+        pos += header.lengths[x];
+    }
+    head.store(pos, std::memory_order_release);
+    return true;
+}
+
+bool LogBuffer::tryPop(TestResult& result, string& text)
+{
+    size_t pos = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == pos)
+        return false;
+
+    RecordHeader header;
+    copyOut(pos, reinterpret_cast<char*>(&header), sizeof(header));
+    size_t fieldPos = pos + sizeof(header);
+    for (int x = 0; x < 2; x++)
+    {
+        text.resize(header.lengths[x]);
+        copyOut(fieldPos, &text[0], header.lengths[x]);
+        fieldPos += header.lengths[x];
+        if (x == 0)
+            result.setTestName(text);
+        else
+            result.setMessage(text);
+    }
+    result.setOutcome(header.outcome);
+    tail.store(pos + header.size, std::memory_order_release);
+    return true;
+}
+
+namespace
+{
+    /**
+    * The calling thread's buffers, one for each Logging it has used.
+    * A Logging owns the buffers, so entries for one that has been
+    * destroyed expire
+    **/
+    struct LocalBuffers
+    {
+        vector<std::pair<unsigned long long, std::weak_ptr<LogBuffer>>> entries;
+
+        ~LocalBuffers()
+        {
+            for (auto& entry : entries)
+                if (auto buffer = entry.second.lock())
+                    buffer->retired = true;
+        }
+    };
+
+    thread_local LocalBuffers localBuffers;
+}
+
+Logging::Logging(LoggingLevel lvl) : logLevel(lvl), output(&std::cout), binaryOutput(false), id(nextLoggingId++), sleeping(false), discarding(false), stopping(false), flushRequests(0), flushed(0) {}
+
+Logging::~Logging()
+{
+    discarding = true;
+    Stop();
+}
+
+void Logging::SetOutput(std::ostream* stream, bool binary)
+{
+    output = stream;
+    binaryOutput = binary;
+}
+
+void Logging::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMtx);
+        stopping = true;
+        wakeCv.notify_one();
+    }
+    if (writer.joinable())
+        writer.join();
+}
 
 LoggingLevel Logging::getLoggingLevel() const { return logLevel; }
 
 string Logging::SuccessValue(bool isSuccessful)
 {
     return isSuccessful ? "PASS" : "FAIL";
-}
\ No newline at end of file
+}
+
+string Logging::SuccessValue(const TestResult& result)
+{
+    string value = SuccessValue(result.getIsSuccessful());
+    return result.getIsCached() ? value + " (cached)" : value;
+}
+
+void Logging::DisplayResult(TestResult& result)
+{
+    std::call_once(writerStarted, [this]() {
+        std::lock_guard<std::mutex> lock(writerMtx);
+        writer = std::thread(&Logging::WriteRecords, this);
+    });
+
+    LogBuffer* buffer = LocalBuffer();
+    while (!buffer->tryPush(result))
+    {
+        // The logging thread is behind; let it catch up.
+        Wake();
+        std::this_thread::yield();
+    }
+
+    // Pairs with the fence in WriteRecords: either the logging thread sees
+    //  the record before it sleeps, or this thread sees it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed))
+        Wake();
+}
+
+void Logging::Flush()
+{
+    std::unique_lock<std::mutex> lock(writerMtx);
+    if (!writer.joinable())
+        return;
+    unsigned long long requested = ++flushRequests;
+    wakeCv.notify_one();
+    flushedCv.wait(lock, [&]() { return flushed >= requested; });
+}
+
+LogBuffer* Logging::LocalBuffer()
+{
+    auto& entries = localBuffers.entries;
+    for (auto& entry : entries)
+    {
+        if (entry.first != id)
+            continue;
+        if (auto buffer = entry.second.lock())
+            return buffer.get();
+    }
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+        [](const std::pair<unsigned long long, std::weak_ptr<LogBuffer>>& entry) { return entry.second.expired(); }),
+        entries.end());
+    auto buffer = std::make_shared<LogBuffer>();
+    {
+        std::lock_guard<std::mutex> lock(buffersMtx);
+        buffers.push_back(buffer);
+    }
+    entries.emplace_back(id, buffer);
+    return buffer.get();
+}
+
+void Logging::Wake()
+{
+    std::lock_guard<std::mutex> lock(writerMtx);
+    wakeCv.notify_one();
+}
+
+bool Logging::Pending()
+{
+    std::lock_guard<std::mutex> lock(buffersMtx);
+    for (auto& buffer : buffers)
+        if (!buffer->empty())
+            return true;
+    return false;
+}
+
+void Logging::WriteRecords()
+{
+    TestResult result;
+    string block;
+    std::unique_lock<std::mutex> lock(writerMtx);
+    while (true)
+    {
+        // Everything logged before these were read is written by the
+        //  drain below.
+        unsigned long long requested = flushRequests;
+        bool stop = stopping;
+        lock.unlock();
+        while (Drain(result, block))
+            ;
+        lock.lock();
+        flushed = requested;
+        flushedCv.notify_all();
+        if (stop)
+            return;
+
+        sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (flushRequests == flushed && !stopping && !Pending())
+            wakeCv.wait(lock);
+        sleeping = false;
+    }
+}
+
+bool Logging::Drain(TestResult& result, string& block)
+{
+    vector<std::shared_ptr<LogBuffer>> current;
+    {
+        std::lock_guard<std::mutex> lock(buffersMtx);
+        // A retired buffer gets no more records, so once empty it's done.
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+            [](const std::shared_ptr<LogBuffer>& buffer) { return buffer->retired && buffer->empty(); }),
+            buffers.end());
+        current = buffers;
+    }
+
+    bool formatted = false;
+    string text;
+    for (auto& buffer : current)
+    {
+        while (buffer->tryPop(result, text))
+        {
+            if (discarding)
+                continue;
+            formatted = true;
+            FormatResult(result, block);
+            if (!binaryOutput)
+                block += '\n';
+            if (block.size() >= BlockSize)
+            {
+                output->write(block.data(), block.size());
+                block.clear();
+            }
+        }
+    }
+    if (!block.empty())
+    {
+        output->write(block.data(), block.size());
+        block.clear();
+    }
+    if (formatted)
+        output->flush();
+    return formatted;
+}
+
+#ifdef BENCH_LOGGING
+
+#include "DetailedLogging.h"
+#include "JUnitLogging.h"
+#include "JsonLinesLogging.h"
+#include <chrono>
+
+/////////////////////////////////////////////////////////////////////
+// Compares the time worker threads spend logging results with this
+// backend against writing each one to cout as it is logged, the way
+// the Logging classes used to, and times the file sinks. Redirect
+// stdout to a file or /dev/null; the table is written to stderr. The
+// sinks leave LoggingBench.xml and LoggingBench.jsonl behind.
+//
+// Run with arguments "[threads] [results per thread]".
+
+// writes each result on the thread that logs it, flushing with endl
+class SynchronousLogging : public DetailedLogging
+{
+public:
+    void DisplayResult(TestResult& result) override
+    {
+        std::cout << result.getTestName() << std::endl;
+        std::cout << SuccessValue(result.getIsSuccessful()) << std::endl;
+        std::cout << result.getMessage() << std::endl;
+        std::cout << std::endl;
+    }
+};
+
+// returns seconds until every thread has logged, and until written
+std::pair<double, double> logResults(Logging& logging, size_t threads, size_t results)
+{
+    auto start = std::chrono::steady_clock::now();
+    vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&logging, results, t]() {
+            TestResult result;
+            result.setTestName("Test " + std::to_string(t));
+            result.setMessage("Test successful");
+            for (size_t x = 0; x < results; x++)
+            {
+                result.setIsSuccessful(x % 10 != 0);
+                logging.DisplayResult(result);
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    double logged = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    logging.Flush();
+    double written = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return { logged, written };
+}
+
+int main(int argc, char* argv[])
+{
+    size_t threads = argc > 1 ? std::stoul(argv[1]) : 4;
+    size_t results = argc > 2 ? std::stoul(argv[2]) : 100000;
+
+    SynchronousLogging synchronous;
+    auto before = logResults(synchronous, threads, results);
+    DetailedLogging asynchronous;
+    auto after = logResults(asynchronous, threads, results);
+    std::pair<double, double> junit, jsonLines;
+    {
+        JUnitLogging sink("LoggingBench.xml");
+        junit = logResults(sink, threads, results);
+    }
+    {
+        JsonLinesLogging sink("LoggingBench.jsonl");
+        jsonLines = logResults(sink, threads, results);
+    }
+
+    double total = double(threads * results);
+    std::cerr << "\n  " << threads << " threads logging " << results << " results each";
+    std::cerr << "\n  ----------------------------------------------";
+    std::cerr << "\n  synchronous:  " << before.first * 1e9 / total << " ns per result";
+    std::cerr << "\n  asynchronous: " << after.first * 1e9 / total << " ns per result in workers, "
+        << after.second * 1e9 / total << " ns until written";
+    std::cerr << "\n  JUnit XML:    " << junit.first * 1e9 / total << " ns per result in workers, "
+        << junit.second * 1e9 / total << " ns until written";
+    std::cerr << "\n  JSON Lines:   " << jsonLines.first * 1e9 / total << " ns per result in workers, "
+        << jsonLines.second * 1e9 / total << " ns until written";
+    std::cerr << "\n\n";
+}
+#endif
@@ -4,6 +4,16 @@
     This file contains the declaration and implementation of the Logging class.
     Abstract base class. Derived classes must provide specific functionality
     related to a particular logging level.
+
+    Results are logged asynchronously. The thread that logs a result copies
+    it into a compact binary record in a buffer of its own, without taking
+    a lock, and a background thread formats the records and writes them to
+    the console in large blocks. Derived classes only decide the format,
+    and may send the text to a file instead of the console.
+
+    The logging thread calls FormatResult, so every class that implements
+    it must call Stop from its destructor. By the time ~Logging runs the
+    derived part is gone; results still queued then are dropped.
 */
 
 #ifndef Logging_h
@@ -11,6 +21,13 @@
 
 #include "TestResult.h"
 #include <string>
+#include <vector>
+#include <ostream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 using std::string;
 
@@ -24,11 +41,17 @@ enum class LoggingLevel
     VERY_DETAILED
 };
 
+/**
+* Single producer, single consumer ring of result records, one per
+* logging thread. Defined in Logging.cpp
+**/
+class LogBuffer;
+
 /**
 * Abstraction of Logging a TestResult
 **/
 class Logging{
-    
+
 public:
     /**
     * Base constructor used to create new instances that derive from Logging
@@ -38,23 +61,54 @@ public:
     Logging(LoggingLevel lvl);
 
     /**
-    * Destructor is virtual to ensure base class destructors are called
+    * Destructor is virtual to ensure base class destructors are called.
+    * Stops the logging thread if the derived class hasn't, dropping any
+    * results not yet written
     **/
     virtual ~Logging();
 
     /**
-    * Displays the formatted results of the test
+    * Queues the result to be formatted and written by the logging thread.
+    * Returns without waiting for the console
     *
     * @result[in] - test result to be displayed
     **/
-    virtual void DisplayResult(TestResult & result) = 0;
+    virtual void DisplayResult(TestResult & result);
 
     /**
-    * Returns the logging level 
+    * Waits until every result queued before the call has been written
+    **/
+    void Flush();
+
+    /**
+    * Returns the logging level
     **/
     LoggingLevel getLoggingLevel() const;
-    
+
 protected:
+    /**
+    * Sends formatted results to stream instead of the console. Call
+    * before the first result is logged
+    *
+    * @stream[in] - where results are written; must outlive the logging thread
+    * @binary[in] - write records exactly as formatted, without a newline after each
+    **/
+    void SetOutput(std::ostream* stream, bool binary = false);
+
+    /**
+    * Writes every queued result and ends the logging thread. Every
+    * class that implements FormatResult calls it from its destructor
+    **/
+    void Stop();
+
+    /**
+    * Appends the formatted result to out. Called on the logging thread
+    *
+    * @result[in] - test result to be formatted
+    * @out[in,out] - text to be written to the console
+    **/
+    virtual void FormatResult(const TestResult& result, string& out) = 0;
+
     /**
     * Returns the success / fail message
     *
@@ -62,8 +116,60 @@ protected:
     **/
     string SuccessValue(bool isSuccessful);
 
+    /**
+    * Returns the success / fail message, noting results from the cache
+    *
+    * @result[in] - test result
+    **/
+    string SuccessValue(const TestResult& result);
+
 private:
+    /**
+    * Returns the calling thread's buffer, creating it on first use
+    **/
+    LogBuffer* LocalBuffer();
+
+    /**
+    * Wakes the logging thread if it is waiting for records
+    **/
+    void Wake();
+
+    /**
+    * Returns true if any buffer holds a record
+    **/
+    bool Pending();
+
+    /**
+    * Body of the logging thread: formats and writes records until stopped
+    **/
+    void WriteRecords();
+
+    /**
+    * Formats every record waiting in the buffers and writes them.
+    * Returns false if there were none
+    **/
+    bool Drain(TestResult& result, string& block);
+
     LoggingLevel logLevel;
+    std::ostream* output;
+    bool binaryOutput;
+    // distinguishes this instance in each thread's table of buffers
+    const unsigned long long id;
+
+    std::mutex buffersMtx;
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+
+    std::once_flag writerStarted;
+    std::thread writer;
+    std::mutex writerMtx;
+    std::condition_variable wakeCv;
+    std::condition_variable flushedCv;
+    std::atomic<bool> sleeping;
+    // set by ~Logging: records are dropped, since FormatResult is gone
+    std::atomic<bool> discarding;
+    bool stopping;
+    unsigned long long flushRequests;
+    unsigned long long flushed;
 };
 
 
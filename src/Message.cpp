@@ -1,15 +1,109 @@
 ///////////////////////////////////////////////////////////////////////////
 // Message.cpp - defines message structure used in communication channel //
-// ver 1.0                                                               //
+// ver 1.2                                                               //
 // Jim Fawcett, CSE687-OnLine Object Oriented Design, Fall 2017          //
 ///////////////////////////////////////////////////////////////////////////
 
 #include "Message.h"
 #include <iostream>
+#include <cstring>
 
 using namespace MsgPassingCommunication;
 using SUtils = Utilities::StringHelper;
 
+namespace
+{
+  // names of the common attributes, as they appear on the wire
+  const std::string NameKey = "name";
+  const std::string CommandKey = "command";
+  const std::string ToKey = "to";
+  const std::string FromKey = "from";
+  const std::string FileKey = "file";
+  const std::string ContentLengthKey = "content-length";
+  const std::string BodyKey = "body";
+
+  bool sameKey(const char* key, size_t length, const std::string& name)
+  {
+    return length == name.size() && std::memcmp(key, name.data(), length) == 0;
+  }
+
+  size_t toSize(const char* str, size_t length)
+  {
+    size_t value = 0;
+    for (size_t i = 0; i < length && str[i] >= '0' && str[i] <= '9'; ++i)
+      value = value * 10 + (str[i] - '0');
+    return value;
+  }
+
+  //----< helpers for binary framing, 32 bit values in network order >---
+
+  void putUint32(std::string& dst, size_t value)
+  {
+    dst += static_cast<char>((value >> 24) & 0xff);
+    dst += static_cast<char>((value >> 16) & 0xff);
+    dst += static_cast<char>((value >> 8) & 0xff);
+    dst += static_cast<char>(value & 0xff);
+  }
+
+  size_t getUint32(const char* src)
+  {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(src);
+    return (size_t(p[0]) << 24) | (size_t(p[1]) << 16) | (size_t(p[2]) << 8) | size_t(p[3]);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Message::Attributes members
+
+//----< access custom attribute by position >--------------------------
+
+Message::KeyValue& Message::Attributes::operator[](size_t i)
+{
+  return (i < InlineCapacity) ? inline_[i] : overflow_[i - InlineCapacity];
+}
+
+const Message::KeyValue& Message::Attributes::operator[](size_t i) const
+{
+  return (i < InlineCapacity) ? inline_[i] : overflow_[i - InlineCapacity];
+}
+//----< returns pointer to value for key, or nullptr >-----------------
+
+const Message::Value* Message::Attributes::find(const Key& key) const
+{
+  for (size_t i = 0; i < count_; ++i)
+  {
+    if ((*this)[i].first == key)
+      return &(*this)[i].second;
+  }
+  return nullptr;
+}
+//----< returns reference to value for key, adding key if needed >-----
+
+Message::Value& Message::Attributes::insert(const Key& key)
+{
+  const Value* pValue = find(key);
+  if (pValue)
+    return const_cast<Value&>(*pValue);
+  if (count_ >= InlineCapacity)
+    overflow_.emplace_back();
+  KeyValue& kv = (*this)[count_++];
+  kv.first = key;
+  kv.second.clear();
+  return kv.second;
+}
+//----< removes all custom attributes >--------------------------------
+/*
+*  - inline strings keep their capacity for reuse
+*/
+void Message::Attributes::clear()
+{
+  count_ = 0;
+  overflow_.clear();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Message members
+
 //----< default constructor results in Message with no attributes >----
 
 Message::Message() {}
@@ -18,170 +112,232 @@ Message::Message() {}
 
 Message::Message(EndPoint to, EndPoint from)
 {
-  attributes_["to"] = to.toString();
-  attributes_["from"] = from.toString();
+  this->to(std::move(to));
+  this->from(std::move(from));
 }
-//----< returns reference to Message attributes >----------------------
+//----< returns reference to custom Message attributes >---------------
 
 Message::Attributes& Message::attributes()
 {
   return attributes_;
 }
+//----< maps key to the bit of its common attribute, or 0 if custom >--
+
+unsigned Message::fieldOf(const char* key, size_t length)
+{
+  switch (length)
+  {
+  case 2:
+    if (sameKey(key, length, ToKey)) return ToField;
+    return 0;
+  case 4:
+    if (sameKey(key, length, NameKey)) return NameField;
+    if (sameKey(key, length, FromKey)) return FromField;
+    if (sameKey(key, length, FileKey)) return FileField;
+    if (sameKey(key, length, BodyKey)) return BodyField;
+    return 0;
+  case 7:
+    if (sameKey(key, length, CommandKey)) return CommandField;
+    return 0;
+  case 14:
+    if (sameKey(key, length, ContentLengthKey)) return ContentLengthField;
+    return 0;
+  default: return 0;
+  }
+}
 //----< adds or modifies an existing attribute >-----------------------
+/*
+*  - common attributes are parsed into their typed fields here, once
+*/
+void Message::attribute(const char* key, size_t keyLength, const char* value, size_t valueLength)
+{
+  unsigned field = fieldOf(key, keyLength);
+  switch (field)
+  {
+  case NameField: name_.assign(value, valueLength); break;
+  case CommandField: command_.assign(value, valueLength); break;
+  case ToField: to_ = EndPoint::fromString(value, valueLength); break;
+  case FromField: from_ = EndPoint::fromString(value, valueLength); break;
+  case FileField: file_.assign(value, valueLength); break;
+  case ContentLengthField: contentLength_ = toSize(value, valueLength); break;
+  case BodyField: body_.assign(value, valueLength); break;
+  default:
+    attributes_.insert(Key(key, keyLength)).assign(value, valueLength);
+    return;
+  }
+  fields_ |= field;
+}
 
 void Message::attribute(const Key& key, const Value& value)
 {
-  attributes_[key] = value;
+  attribute(key.data(), key.size(), value.data(), value.size());
+}
+//----< returns value of any attribute, or empty string >--------------
+
+Message::Value Message::attribute(const Key& key) const
+{
+  Value value;
+  forEachAttribute([&](const Key& k, const Value& v) {
+    if (k == key)
+      value = v;
+  });
+  return value;
+}
+//----< calls f(key, value) for every attribute that has been set >----
+
+template<typename F>
+void Message::forEachAttribute(F f) const
+{
+  if (fields_ & NameField) f(NameKey, name_);
+  if (fields_ & CommandField) f(CommandKey, command_);
+  if (fields_ & ToField) f(ToKey, to_.toString());
+  if (fields_ & FromField) f(FromKey, from_.toString());
+  if (fields_ & FileField) f(FileKey, file_);
+  if (fields_ & ContentLengthField) f(ContentLengthKey, std::to_string(contentLength_));
+  if (fields_ & BodyField) f(BodyKey, body_);
+  for (size_t i = 0; i < attributes_.size(); ++i)
+    f(attributes_[i].first, attributes_[i].second);
 }
 //----< clears all attributes >----------------------------------------
 
 void Message::clear()
 {
+  fields_ = 0;
+  name_.clear();
+  command_.clear();
+  to_ = EndPoint();
+  from_ = EndPoint();
+  file_.clear();
+  contentLength_ = 0;
+  body_.clear();
   attributes_.clear();
 }
 //----< returns vector of attribute keys >-----------------------------
 
-Message::Keys Message::keys()
+Message::Keys Message::keys() const
 {
   Keys keys;
-  keys.reserve(attributes_.size());
-  for (auto kv : attributes_)
-  {
-    keys.push_back(kv.first);
-  }
+  forEachAttribute([&](const Key& k, const Value&) { keys.push_back(k); });
   return keys;
 }
 //---< does this message have key? >-----------------------------------
 
-bool Message::containsKey(const Key& key)
+bool Message::containsKey(const Key& key) const
 {
-  if (attributes_.find(key) != attributes_.end())
-    return true;
-  return false;
+  unsigned field = fieldOf(key.data(), key.size());
+  if (field)
+    return (fields_ & field) != 0;
+  return attributes_.find(key) != nullptr;
 }
 //----< get to attribute >---------------------------------------------
 
-EndPoint Message::to()
+const EndPoint& Message::to() const
 {
-  if (containsKey("to"))
-  {
-    return EndPoint::fromString(attributes_["to"]);
-  }
-  return EndPoint();
+  return to_;
 }
 //----< set to attribute >---------------------------------------------
 
 void Message::to(EndPoint ep)
 {
-  attributes_["to"] = ep.toString();
+  to_ = std::move(ep);
+  fields_ |= ToField;
 }
+//----< get body attribute >-------------------------------------------
 
-void Message::body(std::string b)
+const std::string& Message::body() const
 {
-  attributes_["body"] = b;
-}
-std::string Message::body() {
-    return attributes_["body"];
+  return body_;
 }
+//----< set body attribute >-------------------------------------------
 
+void Message::body(const std::string& b)
+{
+  body_ = b;
+  fields_ |= BodyField;
+}
 //----< get from attribute >-------------------------------------------
 
-EndPoint Message::from()
+const EndPoint& Message::from() const
 {
-  if (containsKey("from"))
-  {
-    return EndPoint::fromString(attributes_["from"]);
-  }
-  return EndPoint();
+  return from_;
 }
 //----< set from attribute >-------------------------------------------
 
 void Message::from(EndPoint ep)
 {
-  attributes_["from"] = ep.toString();
+  from_ = std::move(ep);
+  fields_ |= FromField;
 }
 //----< get name attribute >-------------------------------------------
 
-std::string Message::name()
+const std::string& Message::name() const
 {
-  if (containsKey("name"))
-  {
-    return attributes_["name"];
-  }
-  return "";
+  return name_;
 }
 //----< set name attribute >-------------------------------------------
 
 void Message::name(const std::string& nm)
 {
-  attributes_["name"] = nm;
+  name_ = nm;
+  fields_ |= NameField;
 }
 //----< get command attribute >----------------------------------------
 
-std::string Message::command()
+const std::string& Message::command() const
 {
-  if (containsKey("command"))
-  {
-    return attributes_["command"];
-  }
-  return "";
+  return command_;
 }
 //----< set command attribute >----------------------------------------
 
 void Message::command(const std::string& cmd)
 {
-  attributes_["command"] = cmd;
+  command_ = cmd;
+  fields_ |= CommandField;
 }
 //----< get file name attribute >--------------------------------------
 
-std::string Message::file()
+const std::string& Message::file() const
 {
-  if (containsKey("file"))
-  {
-    return attributes_["file"];
-  }
-  return "";
+  return file_;
 }
 //----< set file name attribute >--------------------------------------
 
 void Message::file(const std::string& fl)
 {
-  attributes_["file"] = fl;
+  file_ = fl;
+  fields_ |= FileField;
 }
 //----< get body length >----------------------------------------------
 
-size_t Message::contentLength()
+size_t Message::contentLength() const
 {
-  if (containsKey("content-length"))
-  {
-    std::string lenStr = attributes_["content-length"];
-    return Utilities::Converter<size_t>::toValue(lenStr);
-  }
-  return 0;
+  return contentLength_;
 }
 //----< set body length >----------------------------------------------
 
 void Message::contentLength(size_t ln)
 {
-  attributes_["content-length"] = Utilities::Converter<size_t>::toString(ln);
+  contentLength_ = ln;
+  fields_ |= ContentLengthField;
 }
 //----< convert message to string representation >---------------------
 
-std::string Message::toString()
+std::string Message::toString() const
 {
   std::string temp;
-  for (auto kv : attributes_)
-  {
-    temp += kv.first + ":" + kv.second + "\n";
-  }
-  return temp + "\n";
+  temp.reserve(128);
+  forEachAttribute([&](const Key& k, const Value& v) {
+    temp.append(k).append(1, ':').append(v).append(1, '\n');
+  });
+  temp += '\n';
+  return temp;
 }
 //----< extracts name from attribute string >--------------------------
 
 Message::Key Message::attribName(const Attribute& attrib)
 {
   size_t pos = attrib.find_first_of(':');
-  if (pos == attrib.length())
+  if (pos == std::string::npos)
     return "";
   return attrib.substr(0, pos);
 }
@@ -190,21 +346,94 @@ Message::Key Message::attribName(const Attribute& attrib)
 Message::Value Message::attribValue(const Attribute& attrib)
 {
   size_t pos = attrib.find_first_of(':');
-  if (pos == attrib.length())
+  if (pos == std::string::npos)
     return "";
   return attrib.substr(pos + 1, attrib.length() - pos);
 }
 //----< creates message from message representation string >-----------
-
+/*
+*  - scans attribute lines in place, without splitting into substrings
+*/
 Message Message::fromString(const std::string& src)
 {
   Message msg;
-  std::vector<std::string> splits = Utilities::StringHelper::split(src);
-  for (Attribute attr : splits)
+  const char* pos = src.data();
+  const char* end = pos + src.size();
+  while (pos < end)
+  {
+    const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    if (!eol)
+      eol = end;
+    const char* colon = static_cast<const char*>(std::memchr(pos, ':', eol - pos));
+    if (colon && colon > pos)
+      msg.attribute(pos, colon - pos, colon + 1, eol - colon - 1);
+    pos = eol + 1;
+  }
+  return msg;
+}
+//----< convert message to length-prefixed binary representation >-----
+/*
+*  - body is not written as a pair, it follows the pairs as raw bytes
+*/
+std::string Message::toBinary() const
+{
+  std::string temp(BinaryHeaderSize, '\0');
+  temp.reserve(128 + body_.size());
+  size_t pairs = 0;
+  forEachAttribute([&](const Key& k, const Value& v) {
+    if (&v == &body_)
+      return;  // body goes last, without a length prefix
+    putUint32(temp, k.size());
+    temp += k;
+    putUint32(temp, v.size());
+    temp += v;
+    ++pairs;
+  });
+  if (fields_ & BodyField)
+    temp += body_;
+
+  std::string header;
+  putUint32(header, temp.size() - BinaryHeaderSize);
+  putUint32(header, pairs);
+  temp.replace(0, BinaryHeaderSize, header);
+  return temp;
+}
+//----< extracts payload length from binary header >-------------------
+
+size_t Message::binaryPayloadLength(const char* header)
+{
+  return getUint32(header);
+}
+//----< creates message from binary header and payload >---------------
+/*
+*  - payload must hold binaryPayloadLength(header) bytes
+*  - stops at the first pair that would run past the payload
+*/
+Message Message::fromBinary(const char* header, const char* payload)
+{
+  Message msg;
+  size_t length = getUint32(header);
+  size_t pairs = getUint32(header + 4);
+  size_t pos = 0;
+  for (size_t i = 0; i < pairs; ++i)
   {
-    if(attribName(attr) != "")
-      msg.attributes()[attribName(attr)] = attribValue(attr);
+    if (length - pos < 4)
+      return msg;
+    size_t keyLen = getUint32(payload + pos);
+    pos += 4;
+    if (length - pos < keyLen + 4)
+      return msg;
+    const char* key = payload + pos;
+    pos += keyLen;
+    size_t valueLen = getUint32(payload + pos);
+    pos += 4;
+    if (length - pos < valueLen)
+      return msg;
+    msg.attribute(key, keyLen, payload + pos, valueLen);
+    pos += valueLen;
   }
+  if (pos < length)
+    msg.attribute(BodyKey.data(), BodyKey.size(), payload + pos, length - pos);
   return msg;
 }
 //----< displays message on std::ostream >-----------------------------
@@ -213,7 +442,7 @@ Message Message::fromString(const std::string& src)
 *  - by default stream is std::cout
 *  - can be replaced by std::ostringstream to get display string
 */
-std::ostream& Message::show(std::ostream& out)
+std::ostream& Message::show(std::ostream& out) const
 {
   std::string temp = toString();  // convert this message to string
   size_t pos = temp.find_last_of('\n');
@@ -252,7 +481,7 @@ int main()
   msg.to(EndPoint("localhost", 8080));
   msg.from(EndPoint("localhost", 8081));
   msg.command("doIt");
-  msg.bodyLength(42);
+  msg.contentLength(42);
   msg.file("someFile");
   msg.show();
 
@@ -260,6 +489,13 @@ int main()
   Message newMsg = Message::fromString(msg.toString());
   newMsg.show();
 
+  SUtils::title("testing Message msg = fromBinary(msg.toBinary())");
+  msg.body("binary bodies may contain\nnewlines");
+  std::string bin = msg.toBinary();
+  std::cout << "\n  binary size = " << bin.size() << ", payload = " << Message::binaryPayloadLength(bin.data());
+  Message binMsg = Message::fromBinary(bin.data(), bin.data() + Message::BinaryHeaderSize);
+  binMsg.show();
+
   SUtils::title("retrieving attributes from message");
   std::cout << "\n  msg name          : " << newMsg.name();
   std::cout << "\n  msg command       : " << newMsg.command();
@@ -286,3 +522,86 @@ int main()
   return 0;
 }
 #endif
+
+//----< benchmark stub >-----------------------------------------------
+
+#ifdef BENCH_MESSAGE
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+/////////////////////////////////////////////////////////////////////
+// Counts heap allocations per Message operation by replacing the
+// global allocation functions for this executable only.
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+  ++allocations;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+//----< a "runtest" message as the harness dispatcher builds it >------
+
+Message makeRuntest(size_t testId)
+{
+  Message msg;
+  msg.to(EndPoint("localhost", 9194));
+  msg.from(EndPoint("localhost", 9192));
+  msg.name("runtest");
+  msg.body(std::to_string(testId));
+  return msg;
+}
+//----< runs op count times, reports allocations and time per op >-----
+
+template<typename Op>
+void measure(const std::string& label, size_t count, Op op)
+{
+  size_t sink = 0;
+  size_t before = allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i)
+    sink += op(i);
+  auto stop = std::chrono::steady_clock::now();
+  size_t allocs = allocations.load() - before;
+  double nsec = std::chrono::duration<double, std::nano>(stop - start).count();
+  std::cout << "\n  " << label << std::string(22 - label.size(), ' ')
+    << double(allocs) / count << " allocs, " << nsec / count << " ns"
+    << (sink == 0 ? " " : "");
+}
+
+int main(int argc, char* argv[])
+{
+  size_t Count = 1000000;
+  if (argc > 1)
+    Count = Utilities::Converter<size_t>::toValue(argv[1]);
+
+  Message msg = makeRuntest(42);
+  std::string text = msg.toString();
+  std::string bin = msg.toBinary();
+
+  SUtils::Title("Message allocations and time per operation");
+  measure("build", Count, [](size_t i) { return makeRuntest(i).contentLength(); });
+  measure("toString", Count, [&](size_t) { return msg.toString().size(); });
+  measure("fromString", Count, [&](size_t) { return Message::fromString(text).contentLength(); });
+  measure("toBinary", Count, [&](size_t) { return msg.toBinary().size(); });
+  measure("fromBinary", Count, [&](size_t) {
+    return Message::fromBinary(bin.data(), bin.data() + Message::BinaryHeaderSize).contentLength();
+  });
+  measure("dispatch getters", Count, [&](size_t) {
+    size_t n = (msg.name() == "runtest") ? 1 : 0;
+    n += msg.to().port + msg.from().port + msg.command().size();
+    return n + std::stoi(msg.body());
+  });
+  std::cout << "\n\n";
+  return 0;
+}
+
+#endif
@@ -1,7 +1,7 @@
 #pragma once
 /////////////////////////////////////////////////////////////////////////
 // Message.h - defines message structure used in communication channel //
-// ver 1.0                                                             //
+// ver 1.2                                                             //
 // Jim Fawcett, CSE687-OnLine Object Oriented Design, Fall 2017        //
 /////////////////////////////////////////////////////////////////////////
 /*
@@ -13,6 +13,14 @@
 *    name:value pairs.
 *  - Message have a number of getter, setter methods for common attributes, and allow
 *    definition of other "custom" attributes.
+*  - The common attributes - name, command, to, from, file, content-length, and
+*    body - are held in typed fields, so getters don't search or reparse.  Custom
+*    attributes live in a small list whose first few entries are stored inline.
+*  - Messages can also be framed in a length-prefixed binary format, which a
+*    receiver reads with two fixed-size reads instead of scanning lines:
+*      header : payload length, key/value pair count - 32 bit, network order
+*      payload: for each pair, 32 bit key length, key, 32 bit value length, value
+*               followed by the raw body, which takes up the rest of the payload
 *
 *  Required Files:
 *  ---------------
@@ -20,13 +28,21 @@
 *
 *  Maintenance History:
 *  --------------------
+*  ver 1.2 : 17 Oct 2026
+*  - replaced unordered_map attribute storage with typed fields for the
+*    common attributes and an inline list for custom attributes
+*  - getters are const and return references
+*  - attributes() now returns only the custom attributes
+*  - added allocation benchmark, compiled with BENCH_MESSAGE
+*  ver 1.1 : 17 Oct 2026
+*  - added WireFormat, toBinary, and fromBinary
 *  ver 1.0 : 03 Oct 2017
 *  - first release
 *
 */
 #include "Utilities.h"
 #include <string>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace MsgPassingCommunication
@@ -41,28 +57,44 @@ namespace MsgPassingCommunication
     Address address;
     Port port;
     EndPoint(Address anAddress = "", Port aPort = 0);
-    std::string toString();
+    std::string toString() const;
     static EndPoint fromString(const std::string& str);
+    static EndPoint fromString(const char* str, size_t length);
   };
 
   inline EndPoint::EndPoint(Address anAddress, Port aPort) : address(anAddress), port(aPort) {}
 
-  inline std::string EndPoint::toString()
+  inline std::string EndPoint::toString() const
   {
-    return address + ":" + Utilities::Converter<size_t>::toString(port);
+    return address + ":" + std::to_string(port);
   }
 
   inline EndPoint EndPoint::fromString(const std::string& str)
+  {
+    return fromString(str.data(), str.size());
+  }
+
+  inline EndPoint EndPoint::fromString(const char* str, size_t length)
   {
     EndPoint ep;
-    size_t pos = str.find_first_of(':');
-    if (pos == str.length())
+    size_t pos = length;
+    while (pos > 0 && str[pos - 1] != ':')
+      --pos;
+    if (pos == 0)
       return ep;
-    ep.address = str.substr(0, pos);
-    std::string portStr = str.substr(pos + 1);
-    ep.port = Utilities::Converter<size_t>::toValue(portStr);
+    ep.address.assign(str, pos - 1);
+    for (; pos < length && str[pos] >= '0' && str[pos] <= '9'; ++pos)
+      ep.port = ep.port * 10 + (str[pos] - '0');
     return ep;
   }
+
+  ///////////////////////////////////////////////////////////////////
+  // WireFormat - how a Sender frames Messages on a connection
+  // - text is the HTTP style format, handy for debugging
+  // - binary is the length-prefixed format
+
+  enum class WireFormat { text, binary };
+
   ///////////////////////////////////////////////////////////////////
   // Message class
   // - follows the style, but not the implementation details of
@@ -74,48 +106,86 @@ namespace MsgPassingCommunication
     using Key = std::string;
     using Value = std::string;
     using Attribute = std::string;
-    using Attributes = std::unordered_map<Key, Value>;
+    using KeyValue = std::pair<Key, Value>;
     using Keys = std::vector<Key>;
 
+    /////////////////////////////////////////////////////////////////
+    // Attributes - custom attributes in insertion order
+    // - the first InlineCapacity entries need no allocation beyond
+    //   what their strings need
+
+    class Attributes
+    {
+    public:
+      static const size_t InlineCapacity = 4;
+      size_t size() const { return count_; }
+      KeyValue& operator[](size_t i);
+      const KeyValue& operator[](size_t i) const;
+      const Value* find(const Key& key) const;
+      Value& insert(const Key& key);
+      void clear();
+    private:
+      KeyValue inline_[InlineCapacity];
+      std::vector<KeyValue> overflow_;
+      size_t count_ = 0;
+    };
+
     Message();
     Message(EndPoint to, EndPoint from);
 
     Attributes& attributes();
     void attribute(const Key& key, const Value& value);
-    Keys keys();
+    Value attribute(const Key& key) const;
+    Keys keys() const;
     static Key attribName(const Attribute& attr);
     static Value attribValue(const Attribute& attr);
-    bool containsKey(const Key& key);
+    bool containsKey(const Key& key) const;
 
-    //std::string body;
-    std::string body();
-    void body(std::string);
+    const std::string& body() const;
+    void body(const std::string& b);
 
-    EndPoint to();
+    const EndPoint& to() const;
     void to(EndPoint ep);
-    EndPoint from();
+    const EndPoint& from() const;
     void from(EndPoint ep);
-    std::string name();
+    const std::string& name() const;
     void name(const std::string& nm);
-    std::string command();
+    const std::string& command() const;
     void command(const std::string& cmd);
-    std::string file();
+    const std::string& file() const;
     void file(const std::string& fl);
-    size_t contentLength();
+    size_t contentLength() const;
     void contentLength(size_t ln);
     void clear();
-    std::string toString();
+    std::string toString() const;
     static Message fromString(const std::string& src);
-    std::ostream& show(std::ostream& out = std::cout);
+
+    static const size_t BinaryHeaderSize = 8;
+    std::string toBinary() const;
+    static size_t binaryPayloadLength(const char* header);
+    static Message fromBinary(const char* header, const char* payload);
+    std::ostream& show(std::ostream& out = std::cout) const;
 
   private:
-    Attributes attributes_;
-    // name            : msgName
-    // command         : msg Command
-    // to              : dst EndPoint
-    // from            : src EndPoint
-    // file            : file name
-    // content-length  : body length in bytes
-    // custom attributes
+    // bits of fields_, one per common attribute
+    enum Field : unsigned
+    {
+      NameField = 1, CommandField = 2, ToField = 4, FromField = 8,
+      FileField = 16, ContentLengthField = 32, BodyField = 64
+    };
+    static unsigned fieldOf(const char* key, size_t length);
+    void attribute(const char* key, size_t keyLength, const char* value, size_t valueLength);
+    template<typename F>
+    void forEachAttribute(F f) const;
+
+    unsigned fields_ = 0;  // which common attributes have been set
+    std::string name_;     // name            : msgName
+    std::string command_;  // command         : msg Command
+    EndPoint to_;          // to              : dst EndPoint
+    EndPoint from_;        // from            : src EndPoint
+    std::string file_;     // file            : file name
+    size_t contentLength_ = 0;  // content-length  : body length in bytes
+    std::string body_;     // body            : message body
+    Attributes attributes_;     // custom attributes
   };
 }
\ No newline at end of file
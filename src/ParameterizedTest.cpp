@@ -0,0 +1,136 @@
+/*
+	ParameterizedTest.cpp
+
+	ParameterizedTest is a class template, implemented in ParameterizedTest.h.
+	This file holds its test stub, compiled with TEST_PARAMETERIZEDTEST, and a
+	benchmark, compiled with BENCH_PARAMETERIZEDTEST.
+*/
+
+#include "ParameterizedTest.h"
+
+#if defined(TEST_PARAMETERIZEDTEST) || defined(BENCH_PARAMETERIZEDTEST)
+
+#include "TestHarness.h"
+#include <cstdint>
+#include <iostream>
+
+// Gray codes of consecutive numbers differ in exactly one bit
+inline unsigned char grayStepIsOneBit(uint32_t x)
+{
+	uint32_t step = (x ^ (x >> 1)) ^ ((x + 1) ^ ((x + 1) >> 1));
+	return (step != 0) & ((step & (step - 1)) == 0);
+}
+
+void grayStepBatch(const uint32_t* inputs, size_t count, unsigned char* passed)
+{
+	// no branches, so the compiler can vectorize it
+	for (size_t x = 0; x < count; x++)
+		passed[x] = grayStepIsOneBit(inputs[x]);
+}
+
+#endif
+
+#ifdef TEST_PARAMETERIZEDTEST
+
+#include "DetailedLogging.h"
+
+int main()
+{
+	std::cout << "\n  Demonstrating ParameterizedTest";
+	std::cout << "\n =================================\n\n";
+
+	// a table, with one wrong entry
+	std::vector<std::pair<int, int>> squares = { { 1, 1 }, { 2, 4 }, { 3, 9 }, { 4, 15 }, { 5, 25 } };
+	ParameterizedTest<std::pair<int, int>> squareTest(squares,
+		[](const std::pair<int, int>& input) { return input.first * input.first == input.second; },
+		"Squares table", "Some squares are wrong");
+	squareTest.setDescribe([](const std::pair<int, int>& input) {
+		return std::to_string(input.first) + " squared is " + std::to_string(input.second);
+	});
+
+	// a generator with a batch check
+	ParameterizedTest<uint32_t> grayTest([](size_t caseNumber) { return (uint32_t)caseNumber; }, 100000,
+		grayStepBatch, "Gray code steps", "Some Gray code steps change several bits");
+
+	// a generator whose check fails now and then, and throws once
+	ParameterizedTest<int> evenTest([](size_t caseNumber) { return (int)caseNumber * 2; }, 1000,
+		[](const int& input) {
+			if (input == 998)
+				throw std::runtime_error("case throws");
+			return input % 64 != 0 || input == 0;
+		}, "Even numbers", "Some cases failed");
+	evenTest.setDescribe([](const int& input) { return std::to_string(input); });
+
+	TestHarness harness(new DetailedLogging);
+	harness.setHistoryFile("");
+	harness.addTest(&squareTest);
+	harness.addTest(&grayTest);
+	harness.addTest(&evenTest);
+	harness.run();
+
+	std::cout << "  Even numbers failed " << evenTest.getFailures().size() << " of " << evenTest.getCaseCount() << " cases\n\n";
+}
+
+#endif
+
+#ifdef BENCH_PARAMETERIZEDTEST
+
+#include "BasicLogging.h"
+#include "LambdaTest.h"
+#include <chrono>
+#include <memory>
+
+/////////////////////////////////////////////////////////////////////
+// Times checking the Gray code property over count inputs, 10000 by
+// default, through the harness: as one LambdaTest per input, as one
+// ParameterizedTest with a per-case check, and as one with a batch
+// check.
+//
+// Run with argument "[count]".
+
+double timeRun(vector<ITest*> tests)
+{
+	auto coutBuf = std::cout.rdbuf(nullptr);
+	auto start = std::chrono::steady_clock::now();
+	{
+		TestHarness harness(new BasicLogging);
+		harness.setHistoryFile("");
+		for (ITest* test : tests)
+			harness.addTest(test);
+		harness.run();
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout.rdbuf(coutBuf);
+	return secs;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+
+	vector<std::unique_ptr<LambdaTest>> lambdas;
+	vector<ITest*> lambdaTests;
+	for (size_t x = 0; x < count; x++)
+	{
+		uint32_t input = (uint32_t)x;
+		lambdas.emplace_back(new LambdaTest([input]() { return grayStepIsOneBit(input) != 0; }, "Gray code step", "failed"));
+		lambdaTests.push_back(lambdas.back().get());
+	}
+	ParameterizedTest<uint32_t> perCase([](size_t caseNumber) { return (uint32_t)caseNumber; }, count,
+		[](const uint32_t& input) { return grayStepIsOneBit(input) != 0; }, "Gray code steps", "failed");
+	ParameterizedTest<uint32_t> batch([](size_t caseNumber) { return (uint32_t)caseNumber; }, count,
+		grayStepBatch, "Gray code steps", "failed");
+
+	double lambdaSecs = timeRun(lambdaTests);
+	double perCaseSecs = timeRun({ &perCase });
+	double batchSecs = timeRun({ &batch });
+
+	std::cout << "\n  " << count << " cases through the harness";
+	std::cout << "\n  ----------------------------------------------";
+	std::cout << "\n  one LambdaTest per case:      " << lambdaSecs * 1e9 / count << " ns per case";
+	std::cout << "\n  ParameterizedTest, per case:  " << perCaseSecs * 1e9 / count << " ns per case";
+	std::cout << "\n  ParameterizedTest, batch:     " << batchSecs * 1e9 / count << " ns per case";
+	std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+	ParameterizedTest.h
+
+	This file contains the declaration and implementation of the ParameterizedTest class template.
+	Derives from ITest interface class. Checks one property against many inputs, taken
+	from a table or made by a generator, as a single test.
+
+	The harness schedules the whole test as one unit. It runs the inputs in chunks,
+	checking for cancellation between them, and remembers which cases failed.
+	A per-case check takes one input. A batch check takes a contiguous chunk of
+	inputs and fills in a pass flag for each, so it can loop over them in a way
+	the compiler can vectorize.
+*/
+
+#pragma once
+
+#include "ITest.h"
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+/**
+* Runs a check over every input in a table or from a generator
+**/
+template <typename T>
+class ParameterizedTest : public ITest
+{
+public:
+	// checks one input
+	using Check = std::function<bool(const T& input)>;
+	// checks count inputs, setting passed[x] to 0 for each that fails;
+	//	passed starts out all 1s
+	using BatchCheck = std::function<void(const T* inputs, size_t count, unsigned char* passed)>;
+	// makes the input for a case number
+	using Generator = std::function<T(size_t caseNumber)>;
+	// describes an input in failure reports
+	using Describe = std::function<string(const T& input)>;
+
+	ParameterizedTest(std::vector<T> tbl, Check chk, string tstName, const string errMsg);
+	ParameterizedTest(std::vector<T> tbl, BatchCheck chk, string tstName, const string errMsg);
+	ParameterizedTest(Generator gen, size_t count, Check chk, string tstName, const string errMsg);
+	ParameterizedTest(Generator gen, size_t count, BatchCheck chk, string tstName, const string errMsg);
+
+	/**
+	* Sets how many inputs are checked between cancellation checks, and
+	* handed to a batch check at once
+	**/
+	void setChunkSize(size_t size) { chunkSize = size < 1 ? 1 : size; }
+
+	/**
+	* Sets how failed inputs are shown in the details; without it only
+	* case numbers are shown
+	**/
+	void setDescribe(Describe dscrb) { describe = dscrb; }
+
+	/**
+	* Returns the number of cases
+	**/
+	size_t getCaseCount() const { return caseCount; }
+
+	/**
+	* Returns the case numbers that failed in the last run
+	**/
+	const std::vector<size_t>& getFailures() const { return failures; }
+
+	/**
+	* Returns true if every case passed
+	**/
+	bool run() override;
+
+	/**
+	* Returns the number of cases run and the first few that failed
+	**/
+	string getDetails() const override { return details; }
+private:
+	// first failed cases listed in the details
+	static const size_t MaxReported = 10;
+
+	// checks count inputs from inputs, starting at case first
+	void checkChunk(const T* inputs, size_t first, size_t count);
+
+	// summarizes a run of the first ran cases
+	void summarize(size_t ran);
+
+	std::vector<T> table;
+	Generator generate;
+	size_t caseCount;
+	Check check;
+	BatchCheck batchCheck;
+	Describe describe;
+	size_t chunkSize = 1024;
+	std::vector<size_t> failures;
+	std::vector<unsigned char> passed;
+	string details;
+};
+
+template <typename T>
+ParameterizedTest<T>::ParameterizedTest(std::vector<T> tbl, Check chk, string tstName, const string errMsg)
+	: ITest(tstName, errMsg), table(std::move(tbl)), caseCount(table.size()), check(chk) {}
+
+template <typename T>
+ParameterizedTest<T>::ParameterizedTest(std::vector<T> tbl, BatchCheck chk, string tstName, const string errMsg)
+	: ITest(tstName, errMsg), table(std::move(tbl)), caseCount(table.size()), batchCheck(chk) {}
+
+template <typename T>
+ParameterizedTest<T>::ParameterizedTest(Generator gen, size_t count, Check chk, string tstName, const string errMsg)
+	: ITest(tstName, errMsg), generate(gen), caseCount(count), check(chk) {}
+
+template <typename T>
+ParameterizedTest<T>::ParameterizedTest(Generator gen, size_t count, BatchCheck chk, string tstName, const string errMsg)
+	: ITest(tstName, errMsg), generate(gen), caseCount(count), batchCheck(chk) {}
+
+template <typename T>
+bool ParameterizedTest<T>::run()
+{
+	CancellationToken token = getCancellationToken();
+	failures.clear();
+
+	// generated inputs are made a chunk at a time into this
+	std::vector<T> generated;
+	for (size_t first = 0; first < caseCount; first += chunkSize)
+	{
+		if (token.isCancelled())
+		{
+			summarize(first);
+			return false;
+		}
+		size_t count = (std::min)(chunkSize, caseCount - first);
+		if (generate)
+		{
+			generated.clear();
+			for (size_t x = 0; x < count; x++)
+				generated.push_back(generate(first + x));
+			checkChunk(generated.data(), first, count);
+		}
+		else
+			checkChunk(table.data() + first, first, count);
+	}
+	summarize(caseCount);
+	return failures.empty();
+}
+
+template <typename T>
+void ParameterizedTest<T>::checkChunk(const T* inputs, size_t first, size_t count)
+{
+	passed.assign(count, 1);
+	if (batchCheck)
+		batchCheck(inputs, count, passed.data());
+	else
+	{
+		for (size_t x = 0; x < count; x++)
+		{
+			// an exception fails its own case, not the rest
+			try
+			{
+				passed[x] = check(inputs[x]) ? 1 : 0;
+			}
+			catch (...)
+			{
+				passed[x] = 0;
+			}
+		}
+	}
+	for (size_t x = 0; x < count; x++)
+		if (!passed[x])
+			failures.push_back(first + x);
+}
+
+template <typename T>
+void ParameterizedTest<T>::summarize(size_t ran)
+{
+	details = std::to_string(ran) + " of " + std::to_string(caseCount) + " cases run, "
+		+ std::to_string(failures.size()) + " failed";
+	for (size_t x = 0; x < failures.size() && x < MaxReported; x++)
+	{
+		size_t caseNumber = failures[x];
+		details += (x == 0 ? ": case " : ", case ") + std::to_string(caseNumber);
+		if (describe)
+			details += " (" + describe(generate ? generate(caseNumber) : table[caseNumber]) + ")";
+	}
+	if (failures.size() > MaxReported)
+		details += ", ...";
+}
@@ -0,0 +1,251 @@
+/*
+	ResultCache.cpp
+
+	This file contains the implementation of the ResultCache class.
+	Remembers the results of tests that passed.
+
+	Keys and digests are 64-bit FNV-1a hashes. Each field of a key is
+	preceded by its length, so no two lists of fields hash the same bytes.
+
+	File layout, integers big-endian:
+		"TRCH"                      magic
+		uint32                      number of entries
+		per entry:
+			uint64                  key
+			uint64                  last used, seconds since the epoch
+			uint32                  length of result
+			TestResult::serialize bytes
+*/
+
+#include "ResultCache.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace
+{
+	const char Magic[4] = { 'T', 'R', 'C', 'H' };
+
+	// entries unused for longer are dropped when the cache is saved
+	const unsigned long long MaxAgeSeconds = 7 * 24 * 60 * 60;
+
+	const unsigned long long FnvOffset = 14695981039346656037ULL;
+	const unsigned long long FnvPrime = 1099511628211ULL;
+
+	void hashBytes(unsigned long long& hash, const char* bytes, size_t count)
+	{
+		for (size_t x = 0; x < count; x++)
+		{
+			hash ^= static_cast<unsigned char>(bytes[x]);
+			hash *= FnvPrime;
+		}
+	}
+
+	void hashField(unsigned long long& hash, const string& field)
+	{
+		unsigned long long length = field.size();
+		for (int shift = 56; shift >= 0; shift -= 8)
+		{
+			char byte = static_cast<char>((length >> shift) & 0xff);
+			hashBytes(hash, &byte, 1);
+		}
+		hashBytes(hash, field.data(), field.size());
+	}
+
+	void putInt(std::string& dst, unsigned long long value, int bytes)
+	{
+		for (int shift = 8 * (bytes - 1); shift >= 0; shift -= 8)
+			dst += static_cast<char>((value >> shift) & 0xff);
+	}
+
+	unsigned long long getInt(const unsigned char* p, int bytes)
+	{
+		unsigned long long value = 0;
+		for (int x = 0; x < bytes; x++)
+			value = (value << 8) | p[x];
+		return value;
+	}
+
+	unsigned long long now()
+	{
+		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	string executablePath()
+	{
+#ifdef _WIN32
+		char path[MAX_PATH];
+		DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+		return string(path, length);
+#else
+		return "/proc/self/exe";
+#endif
+	}
+}
+
+bool ResultCache::load(const string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+	const unsigned char* end = p + data.size();
+
+	if (data.size() < 8 || !std::equal(Magic, Magic + 4, data.begin()))
+		return false;
+	unsigned long long count = getInt(p + 4, 4);
+	p += 8;
+
+	std::unordered_map<unsigned long long, Entry> loaded;
+	for (unsigned long long x = 0; x < count; x++)
+	{
+		if (end - p < 20)
+			return false;
+		unsigned long long key = getInt(p, 8);
+		Entry entry;
+		entry.lastUsed = getInt(p + 8, 8);
+		size_t resultLen = (size_t)getInt(p + 16, 4);
+		if ((size_t)(end - p) < 20 + resultLen)
+			return false;
+		entry.result.assign(reinterpret_cast<const char*>(p + 20), resultLen);
+		loaded[key] = entry;
+		p += 20 + resultLen;
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	results.swap(loaded);
+	return true;
+}
+
+bool ResultCache::save(const string& path)
+{
+	std::string data(Magic, 4);
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		unsigned long long oldest = now() - MaxAgeSeconds;
+		for (auto iter = results.begin(); iter != results.end();)
+		{
+			if (iter->second.lastUsed < oldest)
+				iter = results.erase(iter);
+			else
+				++iter;
+		}
+
+		putInt(data, results.size(), 4);
+		for (auto& entry : results)
+		{
+			putInt(data, entry.first, 8);
+			putInt(data, entry.second.lastUsed, 8);
+			putInt(data, entry.second.result.size(), 4);
+			data += entry.second.result;
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+	return (bool)out;
+}
+
+string ResultCache::moduleDigest(const string& path)
+{
+	string file = path.empty() ? executablePath() : path;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		auto iter = digests.find(file);
+		if (iter != digests.end())
+			return iter->second;
+	}
+
+	std::ifstream in(file, std::ios::binary);
+	if (!in)
+		return "";
+	unsigned long long hash = FnvOffset;
+	std::vector<char> block(64 * 1024);
+	while (in)
+	{
+		in.read(block.data(), block.size());
+		hashBytes(hash, block.data(), (size_t)in.gcount());
+	}
+	char digest[17];
+	snprintf(digest, sizeof(digest), "%016llx", hash);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	digests[file] = digest;
+	return digest;
+}
+
+unsigned long long ResultCache::key(const string& digest, const string& testName, const std::vector<string>& inputs)
+{
+	unsigned long long hash = FnvOffset;
+	hashField(hash, digest);
+	hashField(hash, testName);
+	for (const string& input : inputs)
+		hashField(hash, input);
+	return hash;
+}
+
+bool ResultCache::lookup(unsigned long long key, TestResult& result)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = results.find(key);
+	if (iter == results.end() || !result.deserialize(iter->second.result))
+		return false;
+	iter->second.lastUsed = now();
+	return true;
+}
+
+void ResultCache::store(unsigned long long key, const TestResult& result)
+{
+	Entry entry;
+	entry.result = result.serialize();
+	entry.lastUsed = now();
+	std::lock_guard<std::mutex> lock(mtx);
+	results[key] = entry;
+}
+
+size_t ResultCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return results.size();
+}
+
+#ifdef TEST_RESULTCACHE
+
+#include <iostream>
+
+int main()
+{
+	std::cout << "\n  Demonstrating ResultCache";
+	std::cout << "\n ===========================";
+
+	ResultCache cache;
+	string digest = cache.moduleDigest("");
+	std::cout << "\n  digest of this executable: " << digest;
+
+	TestResult passed;
+	passed.setTestName("adds up");
+	passed.setIsSuccessful(true);
+	passed.setMessage("Test successful");
+	passed.recordStartTime();
+	passed.recordEndTime();
+	cache.store(ResultCache::key(digest, "adds up", {}), passed);
+	cache.save("ResultCache.test");
+
+	ResultCache reloaded;
+	reloaded.load("ResultCache.test");
+	TestResult result;
+	std::cout << "\n  same key: " << (reloaded.lookup(ResultCache::key(digest, "adds up", {}), result) ? result.getMessage() : "miss");
+	std::cout << "\n  new input: " << (reloaded.lookup(ResultCache::key(digest, "adds up", { "data v2" }), result) ? result.getMessage() : "miss");
+	std::cout << "\n  new binary: " << (reloaded.lookup(ResultCache::key("0123456789abcdef", "adds up", {}), result) ? result.getMessage() : "miss");
+	std::cout << "\n\n";
+	std::remove("ResultCache.test");
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+	ResultCache.h
+
+	This file contains the declaration of the ResultCache class.
+	Remembers the results of tests that passed, keyed by a hash of everything
+	the result depends on: the contents of the executable or library holding
+	the test, the test's name, and the inputs it declares. A test whose key is
+	unchanged since it last passed doesn't need to run again. Results are kept
+	in a small binary file.
+*/
+
+#pragma once
+
+#include "TestResult.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+using std::string;
+
+/**
+* Content-addressed store of passing test results carried from run to run
+**/
+class ResultCache
+{
+public:
+	/**
+	* Reads results from a cache file. A missing or unreadable file leaves
+	* the cache empty. Returns true if the file was read.
+	*
+	* @path[in] - cache file to read
+	**/
+	bool load(const string& path);
+
+	/**
+	* Writes results to a cache file, dropping those unused for a week.
+	* Returns false on failure.
+	*
+	* @path[in] - cache file to write
+	**/
+	bool save(const string& path);
+
+	/**
+	* Returns a digest of a file's contents, or of this executable's if
+	* path is empty. Digests are computed once per path per process.
+	* Returns an empty string if the file can't be read.
+	*
+	* @path[in] - executable or library holding tests
+	**/
+	string moduleDigest(const string& path);
+
+	/**
+	* Returns the key of a test's result
+	*
+	* @digest[in] - moduleDigest of the file holding the test
+	* @testName[in] - name of the test
+	* @inputs[in] - inputs the test declares
+	**/
+	static unsigned long long key(const string& digest, const string& testName, const std::vector<string>& inputs);
+
+	/**
+	* Copies the result stored under key into result. Returns false if
+	* there is none.
+	*
+	* @key[in] - key of the result
+	* @result[out] - the stored result
+	**/
+	bool lookup(unsigned long long key, TestResult& result);
+
+	/**
+	* Stores a result under key, replacing any earlier one
+	*
+	* @key[in] - key of the result
+	* @result[in] - result to be stored
+	**/
+	void store(unsigned long long key, const TestResult& result);
+
+	/**
+	* Returns the number of stored results
+	**/
+	size_t size() const;
+
+private:
+	struct Entry
+	{
+		// TestResult::serialize
+		string result;
+		// seconds since the epoch the entry was last looked up or stored
+		unsigned long long lastUsed;
+	};
+	std::unordered_map<unsigned long long, Entry> results;
+	std::unordered_map<string, string> digests;
+	mutable std::mutex mtx;
+};
@@ -0,0 +1,380 @@
+/*
+	ResultJournal.cpp
+
+	This file contains the implementation of the ResultJournal class.
+	Maps a result journal and answers questions about the results in it.
+*/
+
+#include "ResultJournal.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Maps a whole file read-only. Returns false if it can't be opened,
+	//	or is empty.
+	bool mapFile(const string& path, const char*& data, size_t& length)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+			return false;
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == NULL)
+			return false;
+		data = static_cast<const char*>(view);
+		length = static_cast<size_t>(size.QuadPart);
+		return true;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+			return false;
+		// Queries read the records from start to end.
+		madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+		data = static_cast<const char*>(view);
+		length = static_cast<size_t>(info.st_size);
+		return true;
+#endif
+	}
+
+	void unmapFile(const char* data, size_t length)
+	{
+#ifdef _WIN32
+		(void)length;
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<char*>(data), length);
+#endif
+	}
+
+	double seconds(int64_t nanoseconds)
+	{
+		return nanoseconds / 1e9;
+	}
+}
+
+ResultJournal::ResultJournal() :
+	journal(nullptr), journalLength(0), strings(nullptr), stringsLength(0), records(nullptr), count(0) {}
+
+ResultJournal::~ResultJournal()
+{
+	close();
+}
+
+bool ResultJournal::open(const string& path)
+{
+	close();
+	if (!mapFile(path, journal, journalLength))
+		return false;
+	JournalHeader header;
+	if (journalLength < sizeof(header))
+	{
+		close();
+		return false;
+	}
+	memcpy(&header, journal, sizeof(header));
+	if (memcmp(header.magic, JournalMagic, sizeof(JournalMagic)) != 0 ||
+		header.byteOrder != JournalByteOrder || header.recordSize != sizeof(JournalRecord))
+	{
+		close();
+		return false;
+	}
+	// A record cut short by a crash is ignored.
+	records = reinterpret_cast<const JournalRecord*>(journal + sizeof(header));
+	count = (journalLength - sizeof(header)) / sizeof(JournalRecord);
+
+	if (!mapFile(path + ".strings", strings, stringsLength) ||
+		stringsLength < sizeof(JournalStringsMagic) ||
+		memcmp(strings, JournalStringsMagic, sizeof(JournalStringsMagic)) != 0)
+	{
+		close();
+		return false;
+	}
+	const char* p = strings + sizeof(JournalStringsMagic);
+	const char* end = strings + stringsLength;
+	while (end - p >= 4)
+	{
+		uint32_t length;
+		memcpy(&length, p, 4);
+		if (static_cast<size_t>(end - p - 4) < length)
+			break;
+		texts.emplace_back(p + 4, length);
+		p += 4 + length;
+	}
+	return true;
+}
+
+void ResultJournal::close()
+{
+	if (journal != nullptr)
+		unmapFile(journal, journalLength);
+	if (strings != nullptr)
+		unmapFile(strings, stringsLength);
+	journal = strings = nullptr;
+	journalLength = stringsLength = 0;
+	records = nullptr;
+	count = 0;
+	texts.clear();
+}
+
+size_t ResultJournal::size() const
+{
+	return count;
+}
+
+const JournalRecord& ResultJournal::record(size_t index) const
+{
+	return records[index];
+}
+
+string ResultJournal::text(uint32_t number) const
+{
+	// A record can outlive its strings if the writer stopped between them.
+	if (number >= texts.size())
+		return "";
+	return string(texts[number].first, texts[number].second);
+}
+
+long long ResultJournal::find(const string& name) const
+{
+	for (size_t x = 0; x < texts.size(); x++)
+	{
+		if (texts[x].second == name.size() && memcmp(texts[x].first, name.data(), name.size()) == 0)
+			return static_cast<long long>(x);
+	}
+	return -1;
+}
+
+std::vector<TestFailures> ResultJournal::failuresByTest() const
+{
+	// Tallies are indexed by string number, so there's no hashing per record.
+	std::vector<TestFailures> tallies(texts.size(), TestFailures{ "", 0, 0, 0 });
+	for (size_t x = 0; x < count; x++)
+	{
+		const JournalRecord& r = records[x];
+		if (r.name >= tallies.size())
+			continue;
+		TestFailures& tally = tallies[r.name];
+		tally.runs++;
+		if ((r.flags & JournalPassed) == 0)
+		{
+			tally.failures++;
+			tally.lastFailure = (std::max)(tally.lastFailure, r.start);
+		}
+	}
+
+	std::vector<TestFailures> failing;
+	for (size_t x = 0; x < tallies.size(); x++)
+	{
+		if (tallies[x].failures == 0)
+			continue;
+		tallies[x].name = text(static_cast<uint32_t>(x));
+		failing.push_back(std::move(tallies[x]));
+	}
+	std::stable_sort(failing.begin(), failing.end(),
+		[](const TestFailures& a, const TestFailures& b) { return a.failures > b.failures; });
+	return failing;
+}
+
+std::vector<TestDurations> ResultJournal::slowestTests(size_t most) const
+{
+	struct Tally { uint64_t runs; int64_t total; int64_t max; };
+	std::vector<Tally> tallies(texts.size(), Tally{ 0, 0, 0 });
+	for (size_t x = 0; x < count; x++)
+	{
+		const JournalRecord& r = records[x];
+		if (r.name >= tallies.size())
+			continue;
+		Tally& tally = tallies[r.name];
+		tally.runs++;
+		tally.total += r.duration;
+		tally.max = (std::max)(tally.max, r.duration);
+	}
+
+	std::vector<TestDurations> durations;
+	for (size_t x = 0; x < tallies.size(); x++)
+	{
+		if (tallies[x].runs == 0)
+			continue;
+		durations.push_back(TestDurations{ text(static_cast<uint32_t>(x)), tallies[x].runs,
+			seconds(tallies[x].total) / tallies[x].runs, seconds(tallies[x].max) });
+	}
+	size_t kept = (std::min)(most, durations.size());
+	std::partial_sort(durations.begin(), durations.begin() + kept, durations.end(),
+		[](const TestDurations& a, const TestDurations& b) { return a.meanSeconds > b.meanSeconds; });
+	durations.resize(kept);
+	return durations;
+}
+
+std::vector<DurationPoint> ResultJournal::durationTrend(const string& name, size_t points) const
+{
+	std::vector<DurationPoint> trend;
+	long long number = find(name);
+	if (number < 0 || points == 0)
+		return trend;
+
+	std::vector<const JournalRecord*> runs;
+	for (size_t x = 0; x < count; x++)
+	{
+		if (records[x].name == static_cast<uint32_t>(number))
+			runs.push_back(&records[x]);
+	}
+
+	// Spread the runs over the groups as evenly as they go.
+	size_t groups = (std::min)(points, runs.size());
+	for (size_t g = 0; g < groups; g++)
+	{
+		size_t first = runs.size() * g / groups;
+		size_t last = runs.size() * (g + 1) / groups;
+		int64_t total = 0;
+		for (size_t x = first; x < last; x++)
+			total += runs[x]->duration;
+		trend.push_back(DurationPoint{ runs[first]->start, last - first, seconds(total) / (last - first) });
+	}
+	return trend;
+}
+
+#ifdef BENCH_RESULTJOURNAL
+
+#include "JournalLogging.h"
+#include "VeryDetailedLogging.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+
+/////////////////////////////////////////////////////////////////////
+// Logs the same results to a journal and, as console text, to a file,
+// then counts failures by test both ways: with a ResultJournal query,
+// and by reading the text line by line the way a script grepping the
+// console would.
+//
+// Run with arguments "[results] [tests]".
+
+namespace
+{
+	double since(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void logResults(Logging& logging, size_t results, size_t tests)
+	{
+		TestResult result;
+		for (size_t x = 0; x < results; x++)
+		{
+			result.setTestName("Test " + std::to_string(x % tests));
+			result.setIsSuccessful(x % 7 != 0);
+			result.setMessage(x % 7 != 0 ? "Test successful" : "Test failed! val1 is not greater than 100!");
+			result.recordStartTime();
+			result.recordEndTime();
+			logging.DisplayResult(result);
+		}
+		logging.Flush();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t results = argc > 1 ? std::stoul(argv[1]) : 2000000;
+	size_t tests = argc > 2 ? std::stoul(argv[2]) : 200;
+	TestResult::anchorClock();
+	std::remove("ResultJournal.bench");
+	std::remove("ResultJournal.bench.strings");
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		JournalLogging journal("ResultJournal.bench");
+		logResults(journal, results, tests);
+	}
+	double journalWrite = since(start);
+
+	std::ofstream text("ResultJournal.bench.txt", std::ios::binary);
+	std::streambuf* console = std::cout.rdbuf(text.rdbuf());
+	start = std::chrono::steady_clock::now();
+	{
+		VeryDetailedLogging veryDetailed;
+		logResults(veryDetailed, results, tests);
+	}
+	double textWrite = since(start);
+	std::cout.rdbuf(console);
+	text.close();
+
+	start = std::chrono::steady_clock::now();
+	ResultJournal reader;
+	reader.open("ResultJournal.bench");
+	std::vector<TestFailures> failures = reader.failuresByTest();
+	double journalQuery = since(start);
+	start = std::chrono::steady_clock::now();
+	std::vector<TestDurations> slowest = reader.slowestTests(10);
+	double slowestQuery = since(start);
+
+	// each result is name, PASS/FAIL, message, three lines of times, blank line
+	start = std::chrono::steady_clock::now();
+	std::ifstream in("ResultJournal.bench.txt");
+	std::unordered_map<string, size_t> textFailures;
+	string name, line;
+	size_t lineNumber = 0;
+	while (std::getline(in, line))
+	{
+		if (lineNumber % 7 == 0)
+			name = line;
+		else if (lineNumber % 7 == 1 && line == "FAIL")
+			textFailures[name]++;
+		lineNumber++;
+	}
+	double textQuery = since(start);
+	size_t agree = 0;
+	for (const TestFailures& test : failures)
+		agree += textFailures[test.name] == test.failures;
+
+	std::ifstream journalFile("ResultJournal.bench", std::ios::binary | std::ios::ate);
+	std::ifstream textFile("ResultJournal.bench.txt", std::ios::binary | std::ios::ate);
+	std::cout << "\n  " << results << " results of " << tests << " tests";
+	std::cout << "\n  ----------------------------------------------";
+	std::cout << "\n  journal: " << journalFile.tellg() / 1024 << " KB, logged in " << journalWrite << " sec(s)";
+	std::cout << "\n  text:    " << textFile.tellg() / 1024 << " KB, logged in " << textWrite << " sec(s)";
+	std::cout << "\n  failures by test, journal: " << journalQuery * 1e3 << " ms (" << failures.size() << " tests, mapping included)";
+	std::cout << "\n  slowest tests, journal:    " << slowestQuery * 1e3 << " ms";
+	std::cout << "\n  failures by test, text:    " << textQuery * 1e3 << " ms (" << textFailures.size() << " tests, " << agree << " counts agree)";
+	std::cout << "\n\n";
+
+	reader.close();
+	std::remove("ResultJournal.bench");
+	std::remove("ResultJournal.bench.strings");
+	std::remove("ResultJournal.bench.txt");
+}
+
+#endif
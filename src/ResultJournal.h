@@ -0,0 +1,180 @@
+/*
+	ResultJournal.h
+
+	This file contains the declaration of the ResultJournal class and the
+	layout of the result journal written by JournalLogging.
+	The journal is an append-only file of fixed-size records, one per test
+	result, so a reader can map it into memory and index it directly. Test
+	names and messages are stored once each, in a side table named after the
+	journal with ".strings" added, and records refer to them by number.
+
+	Integers are stored in the byte order of the machine that wrote them.
+	The header records it, and the reader refuses a journal written in the
+	other order.
+
+	Journal layout:
+		JournalHeader
+		JournalRecord...
+
+	Side table layout:
+		"TRJSTRNG"                  magic
+		per string, numbered from 0:
+			uint32                  length
+			bytes
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+using std::string;
+
+const char JournalMagic[8] = { 'T', 'R', 'J', 'O', 'U', 'R', 'N', 'L' };
+const char JournalStringsMagic[8] = { 'T', 'R', 'J', 'S', 'T', 'R', 'N', 'G' };
+const uint32_t JournalByteOrder = 0x01020304;
+
+// JournalRecord flags
+const uint32_t JournalPassed = 1;
+const uint32_t JournalCached = 2;
+
+/**
+* Start of the journal
+**/
+struct JournalHeader
+{
+	char magic[8];
+	// JournalByteOrder, as the writer stored it
+	uint32_t byteOrder;
+	uint32_t recordSize;
+};
+
+/**
+* One test result
+**/
+struct JournalRecord
+{
+	// numbers of strings in the side table
+	uint32_t name;
+	uint32_t message;
+	uint32_t flags;
+	uint32_t reserved;
+	// wall-clock nanoseconds since the epoch, zero if not recorded
+	int64_t start;
+	int64_t duration;
+};
+
+static_assert(sizeof(JournalHeader) == 16, "JournalHeader is stored as raw bytes");
+static_assert(sizeof(JournalRecord) == 32, "JournalRecord is stored as raw bytes");
+
+/**
+* How often a test has failed
+**/
+struct TestFailures
+{
+	string name;
+	uint64_t runs;
+	uint64_t failures;
+	// start of the latest failing run, nanoseconds since the epoch
+	int64_t lastFailure;
+};
+
+/**
+* How long a test takes
+**/
+struct TestDurations
+{
+	string name;
+	uint64_t runs;
+	double meanSeconds;
+	double maxSeconds;
+};
+
+/**
+* Mean duration of a run of consecutive results for one test
+**/
+struct DurationPoint
+{
+	// start of the first result, nanoseconds since the epoch
+	int64_t start;
+	uint64_t runs;
+	double meanSeconds;
+};
+
+/**
+* Read-only view of a result journal, mapped into memory. Queries make one
+* pass over the records, without copying them
+**/
+class ResultJournal
+{
+public:
+	ResultJournal();
+	~ResultJournal();
+	ResultJournal(const ResultJournal&) = delete;
+	ResultJournal& operator=(const ResultJournal&) = delete;
+
+	/**
+	* Maps a journal and its side table. Records appended afterwards aren't
+	* seen. Returns false if either file is missing or isn't a journal.
+	*
+	* @path[in] - journal file
+	**/
+	bool open(const string& path);
+
+	/**
+	* Unmaps the files
+	**/
+	void close();
+
+	/**
+	* Returns the number of records
+	**/
+	size_t size() const;
+
+	/**
+	* Returns a record, in the order they were written
+	**/
+	const JournalRecord& record(size_t index) const;
+
+	/**
+	* Returns a string from the side table; empty if there's no such string
+	**/
+	string text(uint32_t number) const;
+
+	/**
+	* Returns the tests that have failed, most failures first
+	**/
+	std::vector<TestFailures> failuresByTest() const;
+
+	/**
+	* Returns the tests with the longest mean duration, slowest first
+	*
+	* @count[in] - most tests to return
+	**/
+	std::vector<TestDurations> slowestTests(size_t count) const;
+
+	/**
+	* Splits the results of one test into consecutive groups and returns
+	* the mean duration of each, oldest first
+	*
+	* @name[in] - test name
+	* @points[in] - most groups to return
+	**/
+	std::vector<DurationPoint> durationTrend(const string& name, size_t points) const;
+
+private:
+	// returns the number of a string, or -1 if it isn't in the side table
+	long long find(const string& text) const;
+
+	const char* journal;
+	size_t journalLength;
+	const char* strings;
+	size_t stringsLength;
+	const JournalRecord* records;
+	size_t count;
+	// start and length of each string in the mapped side table
+	std::vector<std::pair<const char*, uint32_t>> texts;
+};
@@ -1,6 +1,6 @@
 /////////////////////////////////////////////////////////////////////////
-// Sockets.cpp - C++ wrapper for Win32 socket api                      //
-// ver 5.2                                                             //
+// Sockets.cpp - C++ wrapper for Win32 and POSIX socket apis           //
+// ver 5.9                                                             //
 // Jim Fawcett, CSE687 - Object Oriented Design, Spring 2016           //
 // CST 4-187, Syracuse University, 315 443-3948, jfawcett@twcny.rr.com //
 //---------------------------------------------------------------------//
@@ -18,8 +18,42 @@
 #include <memory>
 #include <functional>
 #include <exception>
+#include <cstring>
+#include <algorithm>
 #include "Utilities.h"
 
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <climits>
+#include <poll.h>
+
+/////////////////////////////////////////////////////////////////////////////
+// Winsock names used by the shared implementation
+
+#define SD_RECEIVE SHUT_RD
+#define SD_SEND SHUT_WR
+#define SD_BOTH SHUT_RDWR
+
+inline int closesocket(SOCKET sock) { return ::close(sock); }
+inline int WSAGetLastError() { return errno; }
+
+namespace
+{
+  const int ConnectTimeout = 5000;  // millisec allowed for connect to complete
+  const int AcceptPollTime = 100;   // millisec between checks of stop flag
+}
+#endif
+
 using namespace Sockets;
 using Util = Utilities::StringHelper;
 template<typename T>
@@ -33,19 +67,110 @@ using Show = StaticLogger<1>;
 
 SocketSystem::SocketSystem()
 {
+#ifdef _WIN32
   int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
   if (iResult != 0) {
     Show::write("\n  WSAStartup failed with error = " + Conv<int>::toString(iResult));
   }
+#endif
 }
 //-----< destructor frees winsock lib >--------------------------------------
 
 SocketSystem::~SocketSystem()
 {
+#ifdef _WIN32
   int error = WSACleanup();
+#endif
   Show::write("\n  -- Socket System cleaning up\n");
 }
 
+/////////////////////////////////////////////////////////////////////////////
+// RecvBuffer class members
+
+//----< offset of first terminator from start of unread bytes, or npos >-----
+/*
+*  - unread bytes occupy at most two contiguous runs, the second one
+*    starting at the front of storage after the buffer wraps
+*/
+size_t RecvBuffer::find(byte terminator) const
+{
+  if (count_ == 0)
+    return npos;
+  size_t first = (std::min)(count_, capacity_ - head_);
+  const void* pos = std::memchr(&buf_[head_], terminator, first);
+  if (pos)
+    return static_cast<const byte*>(pos) - &buf_[head_];
+  if (first < count_)
+  {
+    pos = std::memchr(&buf_[0], terminator, count_ - first);
+    if (pos)
+      return first + (static_cast<const byte*>(pos) - &buf_[0]);
+  }
+  return npos;
+}
+//----< copies up to bytes unread bytes into pBuf and consumes them >--------
+
+size_t RecvBuffer::read(byte* pBuf, size_t bytes)
+{
+  bytes = (std::min)(bytes, count_);
+  if (bytes == 0)
+    return 0;  // storage may not be allocated yet
+  size_t first = (std::min)(bytes, capacity_ - head_);
+  std::memcpy(pBuf, &buf_[head_], first);
+  if (first < bytes)
+    std::memcpy(pBuf + first, &buf_[0], bytes - first);
+  consume(bytes);
+  return bytes;
+}
+//----< appends bytes unread bytes to str and consumes them >----------------
+
+void RecvBuffer::take(std::string& str, size_t bytes)
+{
+  bytes = (std::min)(bytes, count_);
+  if (bytes == 0)
+    return;  // storage may not be allocated yet
+  size_t first = (std::min)(bytes, capacity_ - head_);
+  str.append(&buf_[head_], first);
+  if (first < bytes)
+    str.append(&buf_[0], bytes - first);
+  consume(bytes);
+}
+//----< start of contiguous free space following the unread bytes >---------
+
+RecvBuffer::byte* RecvBuffer::writePtr()
+{
+  if (buf_.empty())
+    buf_.resize(capacity_);
+  return &buf_[(head_ + count_) % capacity_];
+}
+//----< size of contiguous free space at writePtr() >------------------------
+
+size_t RecvBuffer::writeSpace() const
+{
+  if (count_ == capacity_)
+    return 0;
+  size_t tail = (head_ + count_) % capacity_;
+  if (tail < head_)
+    return head_ - tail;
+  return capacity_ - tail;
+}
+//----< marks bytes written at writePtr() as unread >------------------------
+
+void RecvBuffer::commit(size_t bytes)
+{
+  count_ += bytes;
+}
+//----< discards bytes from the front >--------------------------------------
+/*
+*  - rewinds to the front of storage when empty, so the next fill gets
+*    the largest possible contiguous space
+*/
+void RecvBuffer::consume(size_t bytes)
+{
+  count_ -= bytes;
+  head_ = (count_ == 0) ? 0 : (head_ + bytes) % capacity_;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Socket class members
 
@@ -53,7 +178,7 @@ SocketSystem::~SocketSystem()
 
 Socket::Socket(IpVer ipver) : ipver_(ipver)
 {
-  ZeroMemory(&hints, sizeof(hints));
+  std::memset(&hints, 0, sizeof(hints));
   hints.ai_family = AF_UNSPEC;
   hints.ai_socktype = SOCK_STREAM;
   hints.ai_protocol = IPPROTO_TCP;
@@ -65,8 +190,12 @@ Socket::Socket(IpVer ipver) : ipver_(ipver)
 */
 Socket::Socket(::SOCKET sock) : socket_(sock)
 {
+#ifndef _WIN32
+  if (socket_ != INVALID_SOCKET)
+    setNonBlocking(socket_);
+#endif
   ipver_ = IP4;
-  ZeroMemory(&hints, sizeof(hints));
+  std::memset(&hints, 0, sizeof(hints));
   hints.ai_family = AF_UNSPEC;
   hints.ai_socktype = SOCK_STREAM;
   hints.ai_protocol = IPPROTO_TCP;
@@ -77,8 +206,9 @@ Socket::Socket(Socket&& s)
 {
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
-  ZeroMemory(&hints, sizeof(hints));
+  std::memset(&hints, 0, sizeof(hints));
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
   hints.ai_protocol = s.hints.ai_protocol;
@@ -90,6 +220,7 @@ Socket& Socket::operator=(Socket&& s)
   if (this == &s) return *this;
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
@@ -112,6 +243,14 @@ void Socket::close()
 {
   if (socket_ != INVALID_SOCKET)
     ::closesocket(socket_);
+  socket_ = INVALID_SOCKET;
+  rcvBuf_.clear();
+#ifndef _WIN32
+  if (epoll_ != -1)
+    ::close(epoll_);
+  epoll_ = -1;
+  epollEvents_ = 0;
+#endif
 }
 //----< tells receiver there will be no more sends from this socket >--------
 
@@ -155,12 +294,12 @@ Socket::~Socket() {
 */
 bool Socket::send(size_t bytes, byte* buffer)
 {
-  size_t bytesSent = 0, bytesLeft = bytes;
+  size_t bytesLeft = bytes;
   byte* pBuf = buffer;
   while (bytesLeft > 0)
   {
-    bytesSent = ::send(socket_, pBuf, bytesLeft, 0);
-    if (socket_ == INVALID_SOCKET || bytesSent == 0)
+    int bytesSent = sendSome(pBuf, bytesLeft);
+    if (socket_ == INVALID_SOCKET || bytesSent <= 0)
       return false;
     bytesLeft -= bytesSent;
     pBuf += bytesSent;
@@ -171,21 +310,91 @@ bool Socket::send(size_t bytes, byte* buffer)
 /*
 *  - bytes must be less than or equal to the size of buffer
 *  - doesn't return until buffer has been filled with requested bytes
+*  - buffered bytes are used first; large remainders bypass the
+*    buffer and go straight into the caller's memory
 */
 bool Socket::recv(size_t bytes, byte* buffer)
 {
-  size_t bytesRecvd = 0, bytesLeft = bytes;
+  size_t bytesLeft = bytes;
   byte* pBuf = buffer;
   while (bytesLeft > 0)
   {
-    bytesRecvd = ::recv(socket_, pBuf, bytesLeft, 0);
-    if (socket_ == INVALID_SOCKET || bytesRecvd == 0)
+    int bytesRecvd;
+    if (rcvBuf_.size() > 0)
+      bytesRecvd = (int)rcvBuf_.read(pBuf, bytesLeft);
+    else if (bytesLeft >= rcvBuf_.capacity())
+      bytesRecvd = recvSome(pBuf, bytesLeft);
+    else if (fillRecvBuffer())
+      bytesRecvd = (int)rcvBuf_.read(pBuf, bytesLeft);
+    else
+      bytesRecvd = 0;
+    if (socket_ == INVALID_SOCKET || bytesRecvd <= 0)
       return false;
     bytesLeft -= bytesRecvd;
     pBuf += bytesRecvd;
   }
   return true;
 }
+//----< sends buffers back to back with gathering writes >------------------
+/*
+*  - doesn't return until every buffer has been sent
+*  - one sendmsg (WSASend on Windows) covers as many buffers as the
+*    transport accepts, so small messages share system calls and segments
+*/
+bool Socket::sendBuffers(const std::vector<std::string>& buffers)
+{
+#ifdef _WIN32
+  std::vector<WSABUF> bufs;
+  bufs.reserve(buffers.size());
+  for (const std::string& buffer : buffers)
+  {
+    if (!buffer.empty())
+      bufs.push_back({ (ULONG)buffer.size(), const_cast<char*>(buffer.data()) });
+  }
+  DWORD bytesSent = 0;
+  return bufs.empty() ||
+    ::WSASend(socket_, bufs.data(), (DWORD)bufs.size(), &bytesSent, 0, NULL, NULL) == 0;
+#else
+  std::vector<iovec> iov;
+  iov.reserve(buffers.size());
+  for (const std::string& buffer : buffers)
+  {
+    if (!buffer.empty())
+      iov.push_back({ const_cast<char*>(buffer.data()), buffer.size() });
+  }
+  size_t first = 0;
+  while (first < iov.size())
+  {
+    msghdr hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov[first];
+    hdr.msg_iovlen = (std::min)(iov.size() - first, (size_t)IOV_MAX);
+    ssize_t bytesSent = ::sendmsg(socket_, &hdr, MSG_NOSIGNAL);
+    if (bytesSent < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (!wouldBlock() || !waitFor(EPOLLOUT))
+        return false;
+      continue;
+    }
+    // skip what was sent, which may end part way through a buffer
+    size_t sent = (size_t)bytesSent;
+    while (sent > 0)
+    {
+      if (sent >= iov[first].iov_len)
+        sent -= iov[first++].iov_len;
+      else
+      {
+        iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + sent;
+        iov[first].iov_len -= sent;
+        sent = 0;
+      }
+    }
+  }
+  return true;
+#endif
+}
 //----< sends a terminator terminated string >-------------------------------
 /*
  *  Doesn't return until entire string has been sent
@@ -193,50 +402,43 @@ bool Socket::recv(size_t bytes, byte* buffer)
  */
 bool Socket::sendString(const std::string& str, byte terminator)
 {
-  size_t bytesSent, bytesRemaining = str.size();
-  const byte* pBuf = &(*str.begin());
+  size_t bytesRemaining = str.size();
+  const byte* pBuf = str.data();
   while (bytesRemaining > 0)
   {
-    bytesSent = ::send(socket_, pBuf, bytesRemaining, 0);
-    if (bytesSent == INVALID_SOCKET || bytesSent == 0)
+    int bytesSent = sendSome(pBuf, bytesRemaining);
+    if (bytesSent == SOCKET_ERROR || bytesSent == 0)
       return false;
     bytesRemaining -= bytesSent;
     pBuf += bytesSent;
   }
-  ::send(socket_, &terminator, 1, 0);
+  sendSome(&terminator, 1);
   return true;
 }
 //----< receives terminator terminated string >------------------------------
 /*
  * - Doesn't return until a terminator byte as been received.
  * - result includes terminator
- * ToDo:
- * - needs reads of one byte to be replaced by bulk reads into a
- *   stream buffer to improve efficiency.
- * - That will require building a circular buffer.
- * - performance seems acceptable, so won't do this now
+ * - reads everything available into rcvBuf_ and scans it with memchr,
+ *   so a whole message usually costs a single recv
  */
 std::string Socket::recvString(byte terminator)
 {
-  static const int buflen = 1;
-  char buffer[1];
   std::string str;
-  bool first = true;
   while (true)
   {
-    iResult = ::recv(socket_, buffer, buflen, 0);
-    if (iResult == 0 || iResult == INVALID_SOCKET)
+    size_t pos = rcvBuf_.find(terminator);
+    if (pos != RecvBuffer::npos)
     {
-      //StaticLogger<1>::write("\n  -- invalid socket in Socket::recvString");
+      rcvBuf_.take(str, pos + 1);
       break;
     }
-    if (buffer[0] == terminator)
+    rcvBuf_.take(str, rcvBuf_.size());  // no terminator yet, keep what we have
+    if (!fillRecvBuffer())
     {
-      // added 9/29/2017
-      str += terminator;
+      //StaticLogger<1>::write("\n  -- invalid socket in Socket::recvString");
       break;
     }
-    str += buffer[0];
   }
   return str;
 }
@@ -252,7 +454,7 @@ std::string Socket::removeTerminator(const std::string& src)
  */
 size_t Socket::sendStream(size_t bytes, byte* pBuf)
 {
-  return ::send(socket_, pBuf, bytes, 0);
+  return sendSome(pBuf, bytes);
 }
 //----< attempt to recv specified number of bytes, but may not send all >----
 /*
@@ -260,21 +462,144 @@ size_t Socket::sendStream(size_t bytes, byte* pBuf)
 */
 size_t Socket::recvStream(size_t bytes, byte* pBuf)
 {
-  return ::recv(socket_, pBuf, bytes, 0);
+  if (rcvBuf_.size() == 0)
+  {
+    if (bytes >= rcvBuf_.capacity())
+      return recvSome(pBuf, bytes);
+    if (!fillRecvBuffer())
+      return 0;
+  }
+  return rcvBuf_.read(pBuf, bytes);
+}
+//----< sends bytes of an open file >----------------------------------------
+/*
+*  - fileDescriptor is a POSIX or CRT file descriptor
+*  - on POSIX the kernel copies straight from the page cache to the socket
+*  - on Windows the file is read through a buffer; its position moves
+*/
+bool Socket::sendFile(int fileDescriptor, size_t offset, size_t bytes)
+{
+#ifdef _WIN32
+  std::vector<byte> buffer(64 * 1024);
+  if (::_lseeki64(fileDescriptor, (__int64)offset, SEEK_SET) < 0)
+    return false;
+  while (bytes > 0)
+  {
+    int bytesRead = ::_read(fileDescriptor, buffer.data(), (unsigned)(std::min)(bytes, buffer.size()));
+    if (bytesRead <= 0 || !send(bytesRead, buffer.data()))
+      return false;
+    bytes -= bytesRead;
+  }
+  return true;
+#else
+  off_t position = (off_t)offset;
+  while (bytes > 0)
+  {
+    ssize_t bytesSent = ::sendfile(socket_, fileDescriptor, &position, bytes);
+    if (bytesSent > 0)
+    {
+      bytes -= bytesSent;
+      continue;
+    }
+    if (bytesSent == 0)
+      return false;  // file shorter than promised
+    if (errno == EINTR)
+      continue;
+    if (!wouldBlock() || !waitFor(EPOLLOUT))
+      return false;
+  }
+  return true;
+#endif
+}
+//----< receives bytes into an open file >----------------------------------
+/*
+*  - writes bytes at offset; bytes already in the recv buffer go first
+*  - on POSIX the rest is spliced from the socket through a pipe into the
+*    file, so it never enters user space
+*  - on Windows it is read through a buffer; the file position moves
+*/
+bool Socket::recvFile(int fileDescriptor, size_t offset, size_t bytes)
+{
+#ifdef _WIN32
+  std::vector<byte> buffer(64 * 1024);
+  if (::_lseeki64(fileDescriptor, (__int64)offset, SEEK_SET) < 0)
+    return false;
+  while (bytes > 0)
+  {
+    size_t bytesRecvd = recvStream((std::min)(bytes, buffer.size()), buffer.data());
+    if (bytesRecvd == 0 || bytesRecvd == (size_t)SOCKET_ERROR
+      || ::_write(fileDescriptor, buffer.data(), (unsigned)bytesRecvd) != (int)bytesRecvd)
+      return false;
+    bytes -= bytesRecvd;
+  }
+  return true;
+#else
+  while (bytes > 0 && rcvBuf_.size() > 0)
+  {
+    byte buffer[4096];
+    size_t buffered = rcvBuf_.read(buffer, (std::min)(bytes, sizeof(buffer)));
+    if (::pwrite(fileDescriptor, buffer, buffered, (off_t)offset) != (ssize_t)buffered)
+      return false;
+    offset += buffered;
+    bytes -= buffered;
+  }
+  if (bytes == 0)
+    return true;
+
+  int pipeFds[2];
+  if (::pipe2(pipeFds, O_CLOEXEC) == -1)
+    return false;
+  ::fcntl(pipeFds[1], F_SETPIPE_SZ, 1024 * 1024);
+  off_t position = (off_t)offset;
+  bool ok = true;
+  while (ok && bytes > 0)
+  {
+    ++recvSyscalls_;
+    ssize_t inPipe = ::splice(socket_, nullptr, pipeFds[1], nullptr, bytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (inPipe == 0)
+      ok = false;  // peer closed
+    else if (inPipe < 0)
+      ok = (errno == EINTR) || (wouldBlock() && waitFor(EPOLLIN));
+    while (ok && inPipe > 0)
+    {
+      ssize_t written = ::splice(pipeFds[0], nullptr, fileDescriptor, &position, inPipe, SPLICE_F_MOVE);
+      if (written > 0)
+      {
+        inPipe -= written;
+        bytes -= written;
+      }
+      else if (written == 0 || errno != EINTR)
+        ok = false;
+    }
+  }
+  ::close(pipeFds[0]);
+  ::close(pipeFds[1]);
+  return ok;
+#endif
 }
 //----< returns bytes available in recv buffer >-----------------------------
 // https://docs.microsoft.com/en-us/windows/win32/api/winsock/nf-winsock-ioctlsocket
 size_t Socket::bytesWaiting()
 {
+#ifdef _WIN32
   unsigned long int ret;
   //::ioctlsocket(socket_, FIONBIO, &ret);
   ::ioctlsocket(socket_, FIONREAD, &ret);
-  return (size_t)ret;
+  return rcvBuf_.size() + (size_t)ret;
+#else
+  int ret = 0;
+  if (::ioctl(socket_, FIONREAD, &ret) == -1)
+    ret = 0;
+  return rcvBuf_.size() + (size_t)ret;
+#endif
 }
 //----< waits for server data, checking every timeToCheck millisec >---------
-
+/*
+*  - on POSIX this is a single epoll wait of at most timeToWait millisec
+*/
 bool Socket::waitForData(size_t timeToWait, size_t timeToCheck)
 {
+#ifdef _WIN32
   size_t MaxCount = timeToWait / timeToCheck;
   static size_t count = 0;
   while (bytesWaiting() == 0)
@@ -285,7 +610,177 @@ bool Socket::waitForData(size_t timeToWait, size_t timeToCheck)
       return false;
   }
   return true;
+#else
+  (void)timeToCheck;  // epoll waits without polling
+  if (bytesWaiting() > 0)
+    return true;
+  return waitFor(EPOLLIN, (int)timeToWait) && bytesWaiting() > 0;
+#endif
+}
+//----< has the peer closed or reset the connection? >----------------------
+/*
+*  - doesn't wait and doesn't consume data
+*  - meant for send-only connections, where the peer never writes, such
+*    as a Sender's; unread data is not taken as a close
+*/
+bool Socket::peerClosed()
+{
+  if (socket_ == INVALID_SOCKET)
+    return true;
+  if (rcvBuf_.size() > 0)
+    return false;
+#ifdef _WIN32
+  fd_set readable;
+  FD_ZERO(&readable);
+  FD_SET(socket_, &readable);
+  timeval noWait = { 0, 0 };
+  if (::select(0, &readable, nullptr, nullptr, &noWait) <= 0)
+    return false;
+  char peek;
+  return ::recv(socket_, &peek, 1, MSG_PEEK) <= 0;
+#else
+  pollfd ready = { socket_, POLLIN | POLLRDHUP, 0 };
+  if (::poll(&ready, 1, 0) <= 0)
+    return false;
+  if (ready.revents & (POLLRDHUP | POLLHUP | POLLERR))
+    return true;
+  char peek;
+  ssize_t peeked = ::recv(socket_, &peek, 1, MSG_PEEK);
+  return peeked == 0 || (peeked < 0 && !wouldBlock());
+#endif
+}
+//----< sends as many bytes as the transport will take >---------------------
+/*
+*  - returns bytes sent, or SOCKET_ERROR
+*  - on POSIX waits on epoll until the socket is writeable
+*/
+int Socket::sendSome(const byte* pBuf, size_t bytes)
+{
+#ifdef _WIN32
+  return ::send(socket_, pBuf, (int)bytes, 0);
+#else
+  while (true)
+  {
+    ssize_t bytesSent = ::send(socket_, pBuf, bytes, MSG_NOSIGNAL);
+    if (bytesSent >= 0)
+      return (int)bytesSent;
+    if (errno == EINTR)
+      continue;
+    if (!wouldBlock() || !waitFor(EPOLLOUT))
+      return SOCKET_ERROR;
+  }
+#endif
+}
+//----< receives whatever is available, up to bytes >------------------------
+/*
+*  - returns bytes received, 0 if peer closed, or SOCKET_ERROR
+*  - on POSIX waits on epoll until the socket is readable
+*/
+int Socket::recvSome(byte* pBuf, size_t bytes)
+{
+#ifdef _WIN32
+  ++recvSyscalls_;
+  return ::recv(socket_, pBuf, (int)bytes, 0);
+#else
+  while (true)
+  {
+    ++recvSyscalls_;
+    ssize_t bytesRecvd = ::recv(socket_, pBuf, bytes, 0);
+    if (bytesRecvd >= 0)
+      return (int)bytesRecvd;
+    if (errno == EINTR)
+      continue;
+    ++recvSyscalls_;
+    if (!wouldBlock() || !waitFor(EPOLLIN))
+      return SOCKET_ERROR;
+  }
+#endif
+}
+//----< reads everything available, up to free space, into rcvBuf_ >-------
+/*
+*  - blocks until at least one byte arrives
+*  - returns false if peer closed or the socket failed
+*/
+bool Socket::fillRecvBuffer()
+{
+  size_t space = rcvBuf_.writeSpace();
+  if (space == 0)
+    return true;  // caller must consume before we can read more
+  int bytesRecvd = recvSome(rcvBuf_.writePtr(), space);
+  if (bytesRecvd == 0 || bytesRecvd == SOCKET_ERROR)
+    return false;
+  rcvBuf_.commit(bytesRecvd);
+  return true;
+}
+//----< transfers buffered bytes and epoll instance, used by moves >-------
+
+void Socket::moveState(Socket& s)
+{
+  rcvBuf_ = std::move(s.rcvBuf_);
+  s.rcvBuf_.clear();
+  recvSyscalls_ = s.recvSyscalls_;
+#ifndef _WIN32
+  if (epoll_ != -1 && epoll_ != s.epoll_)
+    ::close(epoll_);
+  epoll_ = s.epoll_;
+  epollEvents_ = s.epollEvents_;
+  s.epoll_ = -1;
+  s.epollEvents_ = 0;
+#endif
+}
+
+#ifndef _WIN32
+//----< did the last operation fail only because it would block? >----------
+
+bool Socket::wouldBlock()
+{
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+//----< puts descriptor in non-blocking mode, disables Nagle >---------------
+
+void Socket::setNonBlocking(::SOCKET sock)
+{
+  int flags = ::fcntl(sock, F_GETFL, 0);
+  ::fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+  int one = 1;
+  ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+//----< waits until socket_ reports events, error, or hangup >---------------
+/*
+*  - epoll instance is created on first wait and reused after that
+*  - returns false on timeout or if socket_ is invalid
+*/
+bool Socket::waitFor(unsigned events, int timeoutMillisec)
+{
+  if (socket_ == INVALID_SOCKET)
+    return false;
+  if (epoll_ == -1)
+  {
+    epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_ == -1)
+      return false;
+  }
+  if (epollEvents_ != events)
+  {
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = socket_;
+    int op = (epollEvents_ == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (::epoll_ctl(epoll_, op, socket_, &ev) == -1)
+      return false;
+    epollEvents_ = events;
+  }
+  epoll_event ready;
+  while (true)
+  {
+    int n = ::epoll_wait(epoll_, &ready, 1, timeoutMillisec);
+    if (n == -1 && errno == EINTR)
+      continue;
+    return n > 0;
+  }
 }
+#endif
 /////////////////////////////////////////////////////////////////////////////
 // SocketConnector class members
 
@@ -301,6 +796,7 @@ SocketConnecter::SocketConnecter(SocketConnecter&& s) : Socket()
 {
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
@@ -313,6 +809,7 @@ SocketConnecter& SocketConnecter::operator=(SocketConnecter&& s)
   if (this == &s) return *this;
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
@@ -329,8 +826,9 @@ SocketConnecter::~SocketConnecter()
 
 bool SocketConnecter::connect(const std::string& ip, size_t port)
 {
-  size_t uport = htons((u_short)port);
-  std::string sPort = Conv<size_t>::toString(uport);
+  close();  // release any previous connection
+
+  std::string sPort = Conv<size_t>::toString(port);
 
   // Resolve the server address and port
   const char* pTemp = ip.c_str();
@@ -372,10 +870,25 @@ bool SocketConnecter::connect(const std::string& ip, size_t port)
       return false;
     }
 
+#ifdef _WIN32
     iResult = ::connect(socket_, ptr->ai_addr, (int)ptr->ai_addrlen);
+#else
+    setNonBlocking(socket_);
+    iResult = ::connect(socket_, ptr->ai_addr, ptr->ai_addrlen);
+    if (iResult == SOCKET_ERROR && errno == EINPROGRESS)
+    {
+      // non-blocking connect completes when the socket becomes writeable
+      int error = ETIMEDOUT;
+      socklen_t len = sizeof(error);
+      if (waitFor(EPOLLOUT, ConnectTimeout))
+        ::getsockopt(socket_, SOL_SOCKET, SO_ERROR, &error, &len);
+      iResult = (error == 0) ? 0 : SOCKET_ERROR;
+      errno = error;
+    }
+#endif
     if (iResult == SOCKET_ERROR) {
-      socket_ = INVALID_SOCKET;
       int error = WSAGetLastError();
+      close();
       Show::write("\n  -- WSAGetLastError returned " + Conv<int>::toString(error));
       continue;
     }
@@ -399,7 +912,7 @@ bool SocketConnecter::connect(const std::string& ip, size_t port)
 SocketListener::SocketListener(size_t port, IpVer ipv) : Socket(ipv), port_(port)
 {
   socket_ = INVALID_SOCKET;
-  ZeroMemory(&hints, sizeof(hints));
+  std::memset(&hints, 0, sizeof(hints));
   if (ipv == Socket::IP6)
     hints.ai_family = AF_INET6;       // use this if you want an IP6 address
   else
@@ -414,6 +927,7 @@ SocketListener::SocketListener(SocketListener&& s) : Socket()
 {
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
@@ -427,6 +941,7 @@ SocketListener& SocketListener::operator=(SocketListener&& s)
   if (this == &s) return *this;
   socket_ = s.socket_;
   s.socket_ = INVALID_SOCKET;
+  moveState(s);
   ipver_ = s.ipver_;
   hints.ai_family = s.hints.ai_family;
   hints.ai_socktype = s.hints.ai_socktype;
@@ -438,6 +953,7 @@ SocketListener& SocketListener::operator=(SocketListener&& s)
 
 SocketListener::~SocketListener()
 {
+  stop();
   Show::write("\n  -- SocketListener instance destroyed");
 }
 //----< binds SocketListener to a network adddress on local machine >--------
@@ -448,9 +964,7 @@ bool SocketListener::bind()
 
   // Resolve the server address and port
 
-  size_t uport = ::htons((u_short)port_);
-  StaticLogger<1>::write("\n  -- netstat uport = " + Utilities::Converter<size_t>::toString(uport));
-  std::string sPort = Conv<size_t>::toString(uport);
+  std::string sPort = Conv<size_t>::toString(port_);
   iResult = getaddrinfo(NULL, sPort.c_str(), &hints, &result);
   if (iResult != 0) {
     Show::write("\n  -- getaddrinfo failed with error: " + Conv<int>::toString(iResult));
@@ -470,6 +984,15 @@ bool SocketListener::bind()
       continue;
     }
     Show::write("\n  -- server created ListenSocket");
+#ifndef _WIN32
+    // allow quick restarts while old connections sit in TIME_WAIT, and
+    // accept IPv4 clients on an IPv6 listener, as Windows does
+    int on = 1, off = 0;
+    ::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (pResult->ai_family == AF_INET6)
+      ::setsockopt(socket_, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    setNonBlocking(socket_);
+#endif
 
     // Setup the TCP listening socket
 
@@ -509,7 +1032,19 @@ bool SocketListener::listen()
 
 Socket SocketListener::accept()
 {
+#ifndef _WIN32
+  // wait in short slices so stop() is noticed without a wake-up connection
+  while (!waitFor(EPOLLIN, AcceptPollTime))
+  {
+    if (stop_.load())
+      return Socket(INVALID_SOCKET);
+  }
   ::SOCKET sock = ::accept(socket_, NULL, NULL);
+  if (sock == INVALID_SOCKET && (wouldBlock() || errno == EINTR || errno == ECONNABORTED))
+    return Socket(INVALID_SOCKET);  // lost race with client, try again
+#else
+  ::SOCKET sock = ::accept(socket_, NULL, NULL);
+#endif
   Socket clientSocket = sock;    // uses Socket(::SOCKET) promotion ctor
   if (!clientSocket.validState()) {
     acceptFailed_ = true;
@@ -527,7 +1062,61 @@ Socket SocketListener::accept()
 void SocketListener::stop()
 {
   stop_.exchange(true);
+#ifdef _WIN32
   sendString("Stop!");
+#endif
+  if (listenThread_.joinable() && listenThread_.get_id() != std::this_thread::get_id())
+    listenThread_.join();
+
+  // the listen thread is gone, so clients_ no longer grows
+  for (Client& client : clients_)
+  {
+    if (!client.done->load())
+      ::shutdown(client.handle, SD_BOTH);
+    if (client.thread.joinable() && client.thread.get_id() != std::this_thread::get_id())
+      client.thread.join();
+#ifndef _WIN32
+    ::close(client.handle);
+#endif
+  }
+  clients_.clear();
+}
+//----< binds and listens without starting a listen thread >----------------
+/*
+*  - the caller accepts connections itself; on POSIX the socket is
+*    non-blocking, so it can wait for them with epoll
+*/
+bool SocketListener::open()
+{
+  return bind() && listen();
+}
+//----< records a client handler, after joining those that finished >-------
+/*
+*  - called on the listen thread before the handler thread starts
+*  - on POSIX the handle is a duplicate descriptor, so shutting it down
+*    can't hit an unrelated socket that reused a closed descriptor number
+*/
+void SocketListener::addClient(Client&& client, Socket& clientSocket)
+{
+  for (auto iter = clients_.begin(); iter != clients_.end();)
+  {
+    if (iter->done->load())
+    {
+      iter->thread.join();
+#ifndef _WIN32
+      ::close(iter->handle);
+#endif
+      iter = clients_.erase(iter);
+    }
+    else
+      ++iter;
+  }
+#ifdef _WIN32
+  client.handle = clientSocket;
+#else
+  client.handle = ::fcntl(clientSocket, F_DUPFD_CLOEXEC, 0);
+#endif
+  clients_.push_back(std::move(client));
 }
 
 #ifdef TEST_SOCKETS
@@ -543,7 +1132,7 @@ void SocketListener::stop()
 class ClientHandler
 {
 public:
-  void operator()(Socket& socket_);
+  void operator()(Socket socket_);
   bool testStringHandling(Socket& socket_);
   bool testBufferHandling(Socket& socket_);
 };
@@ -556,7 +1145,7 @@ void clearBuffer(Socket::byte* buffer, size_t BufLen)
     buffer[i] = '\0';
 }
 
-void ClientHandler::operator()(Socket& socket_)
+void ClientHandler::operator()(Socket socket_)
 {
   while (true)
   {
@@ -691,7 +1280,7 @@ bool ClientHandler::testBufferHandling(Socket& socket_)
     }
   }
   Show::write("\n  End of buffer handling test in ClientHandler");
-  ::Sleep(4000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(4000));
   return true;
 }
 
@@ -793,14 +1382,30 @@ void clientTestBufferHandling(Socket& si)
     }
   }
 }
+//----< empty buffer reads and takes nothing, before storage exists >--------
+
+bool testEmptyRecvBuffer()
+{
+  RecvBuffer rb;
+  std::string str;
+  Socket::byte buffer[4];
+  rb.take(str, 0);
+  rb.take(str, 10);
+  return str.empty() && rb.read(buffer, 0) == 0 && rb.read(buffer, sizeof(buffer)) == 0;
+}
 //----< demonstration >------------------------------------------------------
 
-int main(int argc, char* argv[])
+int main()
 {
   Show::attach(&std::cout);
   Show::start();
   Show::title("Testing Sockets", '=');
 
+  if (testEmptyRecvBuffer())
+    Show::write("\n  ----Empty RecvBuffer test passed\n");
+  else
+    Show::write("\n  ----Empty RecvBuffer test failed\n");
+
   try
   {
     SocketSystem ss;
@@ -812,7 +1417,7 @@ int main(int argc, char* argv[])
     while (!si.connect("localhost", 9070))
     {
       Show::write("\n  client waiting to connect");
-      ::Sleep(100);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     Show::title("Starting string test on client");
@@ -839,3 +1444,88 @@ int main(int argc, char* argv[])
 }
 
 #endif
+
+#ifdef BENCH_SOCKETS
+
+//----< benchmark stub >-----------------------------------------------------
+/*
+*  Measures round-trip latency of a message sized string over loopback.
+*  Build the same stub on Windows and on Linux to compare the Winsock
+*  and POSIX/epoll implementations.
+*/
+#include <algorithm>
+#include <chrono>
+
+//----< echoes every string it receives until the client closes >-----------
+
+class EchoHandler
+{
+public:
+  void operator()(Socket socket_)
+  {
+    while (true)
+    {
+      std::string str = socket_.recvString();
+      if (str.size() == 0 || !socket_.send(str.size(), (Socket::byte*)str.data()))
+        break;
+    }
+  }
+};
+
+int main(int argc, char* argv[])
+{
+#ifdef _WIN32
+  const char* platform = "Winsock";
+#else
+  const char* platform = "POSIX/epoll";
+#endif
+  size_t RoundTrips = 10000;
+  if (argc > 1)
+    RoundTrips = Conv<size_t>::toValue(argv[1]);
+
+  SocketSystem ss;
+  SocketListener sl(9071, Socket::IP6);
+  EchoHandler eh;
+  sl.start(eh);
+
+  SocketConnecter si;
+  while (!si.connect("localhost", 9071))
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // roughly the size of a "runtest" Message in its text form
+  std::string msg =
+    "name:runtest\ncommand:\nto:localhost:9194\nfrom:localhost:9192\nbody:42";
+
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> micros;
+  micros.reserve(RoundTrips);
+  for (size_t i = 0; i < RoundTrips + RoundTrips / 10; ++i)
+  {
+    Clock::time_point start = Clock::now();
+    si.sendString(msg);
+    std::string echo = si.recvString();
+    Clock::time_point stop = Clock::now();
+    if (echo.size() != msg.size() + 1)
+    {
+      std::cout << "\n  echo failed after " << i << " round trips\n";
+      return 1;
+    }
+    if (i >= RoundTrips / 10)  // first tenth is warmup
+      micros.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+  }
+  si.shutDownSend();
+  sl.stop();
+
+  std::sort(micros.begin(), micros.end());
+  double sum = 0;
+  for (double m : micros)
+    sum += m;
+  std::cout << "\n  " << platform << " round trip, " << micros.size() << " messages of " << msg.size() + 1 << " bytes";
+  std::cout << "\n    mean   : " << sum / micros.size() << " usec";
+  std::cout << "\n    median : " << micros[micros.size() / 2] << " usec";
+  std::cout << "\n    p99    : " << micros[micros.size() * 99 / 100] << " usec";
+  std::cout << "\n    max    : " << micros.back() << " usec\n\n";
+  return 0;
+}
+
+#endif
@@ -1,8 +1,8 @@
 #ifndef SOCKETS_H
 #define SOCKETS_H
 /////////////////////////////////////////////////////////////////////////
-// Sockets.h - C++ wrapper for Win32 socket api                        //
-// ver 5.2                                                             //
+// Sockets.h - C++ wrapper for Win32 and POSIX socket apis             //
+// ver 5.9                                                             //
 // Jim Fawcett, CSE687 - Object Oriented Design, Spring 2016           //
 // CST 4-187, Syracuse University, 315 443-3948, jfawcett@twcny.rr.com //
 //---------------------------------------------------------------------//
@@ -15,7 +15,8 @@
 /*
 *  Package Operations:
 *  -------------------
-*  Provides four classes that wrap the Winsock API:
+*  Provides four classes that wrap the Winsock API, or the POSIX
+*  sockets API with epoll on Linux:
 *  Socket:
 *  - provides all the functionality necessary to handle server clients
 *  - created by SocketListener after accepting a request
@@ -26,9 +27,18 @@
 *  - adds the ability to listen for connections on a dedicated thread
 *  - instances of this class are the only ones influenced by ipVer().
 *    clients will use whatever protocol the server provides.
+*  RecvBuffer:
+*  - circular buffer each Socket reads into in bulk
+*  - recvString, recv, and recvStream are all served from it
 *  SocketSystem:
 *  - Loads and unloads winsock2 library.  
 *  - Declared once at beginning of execution
+*  - nothing to load on POSIX, so there it does nothing
+*
+*  On POSIX every socket is non-blocking.  Operations that would block
+*  wait on a small per-socket epoll instance instead, so the public
+*  interface keeps its blocking semantics, and SocketListener can poll
+*  its stop flag rather than sitting in accept forever.
 *
 *  Required Files:
 *  ---------------
@@ -39,6 +49,35 @@
 *
 *  Maintenance History:
 *  --------------------
+*  ver 5.9 : 17 Oct 2026
+*  - added sendBuffers, which sends several buffers with one gathering
+*    system call where the transport will take them
+*  ver 5.8 : 17 Oct 2026
+*  - added SocketListener::open, which binds and listens without starting
+*    a listen thread, for callers that accept on their own event loop
+*  ver 5.7 : 17 Oct 2026
+*  - added peerClosed, so a pooled connection can be checked before reuse
+*  - SocketListener keeps its listen and client handler threads instead
+*    of detaching them; stop() shuts down the client connections and
+*    waits for the threads, so no handler outlives the objects it uses
+*  ver 5.6 : 17 Oct 2026
+*  - added sendFile and recvFile, which move file bytes with sendfile(2)
+*    and splice(2) on POSIX so they are never copied through user space
+*  ver 5.5 : 17 Oct 2026
+*  - connect and bind pass the port to getaddrinfo in host byte order;
+*    the byte-swapped value landed in the ephemeral range and could
+*    collide with ports of outgoing connections
+*  ver 5.4 : 17 Oct 2026
+*  - added RecvBuffer; recvString now reads everything available in one
+*    call and scans for the terminator with memchr instead of reading
+*    one byte per call
+*  - bytesWaiting and waitForData account for buffered bytes
+*  - added recvSyscallCount and a syscalls-per-Message benchmark in Comm.cpp
+*  ver 5.3 : 17 Oct 2026
+*  - added POSIX implementation using non-blocking sockets and epoll
+*  - Socket(IpVer) now initializes socket_ to INVALID_SOCKET and
+*    close() invalidates the handle, so connect can reuse a socket
+*  - added round-trip latency benchmark, compiled with BENCH_SOCKETS
 *  ver 5.2 : 05 Oct 2017
 *  - changed Socket::recvString to append the terminating character, 
 *    newline by default
@@ -105,10 +144,6 @@
 /*
 * ToDo:
 * - make SocketSystem a reference counted instance of Socket
-* - write buffered recv which efficiently returns string or line
-*   - reads and concatenates everything available into circular buffer
-*   - parses out first string or line and moves start of buffer pointer
-*     to begining of next
 * -----------------------------------------------------------------------
 *  Wait for The next items until Students have submitted their code
 * -----------------------------------------------------------------------
@@ -117,6 +152,8 @@
 * - Test and Display packages
 */
 
+#ifdef _WIN32
+
 #ifndef WIN32_LEAN_AND_MEAN  // prevents duplicate includes of core parts of windows.h in winsock2.h
 #define WIN32_LEAN_AND_MEAN
 #endif
@@ -126,17 +163,37 @@
 #include <WS2tcpip.h>     // support for IPv6 and other things
 #include <IPHlpApi.h>     // ip helpers
 
+#pragma warning(disable:4522)
+#pragma comment(lib, "Ws2_32.lib")
+
+#else
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+
+/////////////////////////////////////////////////////////////////////////////
+// Winsock names used by the Socket interface, mapped onto POSIX descriptors
+
+using SOCKET = int;
+const SOCKET INVALID_SOCKET = -1;
+const int SOCKET_ERROR = -1;
+
+#endif
+
 #include <vector>
 #include <string>
 #include <atomic>
+#include <thread>
+#include <memory>
 
 #include "WindowsHelpers.h"
 #include "Utilities.h"
 #include "Logger.h"
 
-#pragma warning(disable:4522)
-#pragma comment(lib, "Ws2_32.lib")
-
 namespace Sockets
 {
   /////////////////////////////////////////////////////////////////////////////
@@ -149,7 +206,38 @@ namespace Sockets
     ~SocketSystem();
   private:
     int iResult;
+#ifdef _WIN32
     WSADATA wsaData;
+#endif
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  // RecvBuffer class
+  // - circular buffer of bytes read from a socket but not yet consumed
+  // - storage is allocated on first fill, so send-only sockets pay nothing
+
+  class RecvBuffer
+  {
+  public:
+    using byte = char;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    RecvBuffer(size_t capacity = 64 * 1024) : capacity_(capacity) {}
+    size_t size() const { return count_; }
+    size_t capacity() const { return capacity_; }
+    size_t find(byte terminator) const;
+    size_t read(byte* pBuf, size_t bytes);
+    void take(std::string& str, size_t bytes);
+    byte* writePtr();
+    size_t writeSpace() const;
+    void commit(size_t bytes);
+    void clear() { head_ = 0; count_ = 0; }
+  private:
+    void consume(size_t bytes);
+    std::vector<byte> buf_;
+    size_t capacity_;
+    size_t head_ = 0;   // index of first unread byte
+    size_t count_ = 0;  // number of unread bytes
   };
 
   /////////////////////////////////////////////////////////////////////////////
@@ -176,24 +264,43 @@ namespace Sockets
 
     IpVer& ipVer();
     bool send(size_t bytes, byte* buffer);
+    bool sendBuffers(const std::vector<std::string>& buffers);
     bool recv(size_t bytes, byte* buffer);
     size_t sendStream(size_t bytes, byte* buffer);
     size_t recvStream(size_t bytes, byte* buffer);
+    bool sendFile(int fileDescriptor, size_t offset, size_t bytes);
+    bool recvFile(int fileDescriptor, size_t offset, size_t bytes);
     bool sendString(const std::string& str, byte terminator = '\0');
     std::string recvString(byte terminator = '\0');
     static std::string removeTerminator(const std::string& src);
     size_t bytesWaiting();
     bool waitForData(size_t timeToWait, size_t timeToCheck);
+    bool peerClosed();
     bool shutDownSend();
     bool shutDownRecv();
     bool shutDown();
     void close();
+    size_t recvSyscallCount() const { return recvSyscalls_; }
 
     bool validState() { return socket_ != INVALID_SOCKET; }
 
   protected:
+    int sendSome(const byte* pBuf, size_t bytes);
+    int recvSome(byte* pBuf, size_t bytes);
+    bool fillRecvBuffer();
+    void moveState(Socket& s);
+#ifdef _WIN32
     WSADATA wsaData;
-    ::SOCKET socket_;
+#else
+    static bool wouldBlock();
+    static void setNonBlocking(::SOCKET sock);
+    bool waitFor(unsigned events, int timeoutMillisec = -1);
+    int epoll_ = -1;
+    unsigned epollEvents_ = 0;
+#endif
+    RecvBuffer rcvBuf_;
+    size_t recvSyscalls_ = 0;  // recv and wait calls made on behalf of receives
+    ::SOCKET socket_ = INVALID_SOCKET;
     struct addrinfo *result = NULL, *ptr = NULL, hints;
     int iResult;
     IpVer ipver_ = IP4;
@@ -221,6 +328,7 @@ namespace Sockets
   // SocketListener class
   // - listens for incoming connections
   // - each connection is handled on its own thread
+  // - stop() closes the connections and waits for their threads
 
   class SocketListener : public Socket
   {
@@ -235,14 +343,24 @@ namespace Sockets
 
     template<typename CallObj>
     bool start(CallObj& co);
+    bool open();
     void stop();
   private:
+    struct Client
+    {
+      std::thread thread;
+      ::SOCKET handle;  // used only to shut the connection down
+      std::shared_ptr<std::atomic<bool>> done;
+    };
     bool bind();
     bool listen();
     Socket accept();
+    void addClient(Client&& client, Socket& clientSocket);
     std::atomic<bool> stop_ = false;
     size_t port_;
     bool acceptFailed_ = false;
+    std::thread listenThread_;
+    std::vector<Client> clients_;  // touched only by the listen thread until it stops
   };
 
   //----< SocketListener start function runs listener on its own thread >------
@@ -266,8 +384,9 @@ namespace Sockets
     }
     // listen on a dedicated thread so server's main thread won't block
 
-    std::thread ListenThread(
-      [&]()
+    CallObj* pCo = &co;
+    listenThread_ = std::thread(
+      [this, pCo]()
     {
       StaticLogger<1>::write("\n  -- server waiting for connection");
 
@@ -284,16 +403,22 @@ namespace Sockets
         }
         StaticLogger<1>::write("\n  -- server accepted connection");
 
-        // start thread to handle client request
+        // start thread to handle client request, on a copy of co
 
-        //std::thread clientThread(std::ref(co), std::move(clientSocket));
-        std::thread clientThread(co, std::move(clientSocket));
-        clientThread.detach();  // detach - listener won't access thread again
+        Client client;
+        client.done = std::make_shared<std::atomic<bool>>(false);
+        addClient(std::move(client), clientSocket);
+        auto done = clients_.back().done;
+        clients_.back().thread = std::thread(
+          [done](CallObj handler, Socket socket) {
+            handler(std::move(socket));
+            done->store(true);
+          },
+          *pCo, std::move(clientSocket));
       }
       StaticLogger<1>::write("\n  -- Listen thread stopping");
     }
     );
-    ListenThread.detach();
     return true;
   }
 }
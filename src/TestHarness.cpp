@@ -7,6 +7,24 @@
 
 #include "TestHarness.h"
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <deque>
+#include <set>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#ifndef _WIN32
+#include <cstdio>
+#include <cstring>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif
 
 
 using std::thread;
@@ -14,50 +32,1225 @@ using namespace Sockets;
 using namespace MsgPassingCommunication;
 using std::cout;
 using std::endl;
+using std::chrono::steady_clock;
 
-TestHarness::TestHarness(Logging* log) : logging(log) {}
+namespace
+{
+	// how long a cancelled test has to return before its worker is replaced
+	const std::chrono::milliseconds CancelGrace(250);
+	// how often the watchdog looks for overdue tests
+	const std::chrono::milliseconds WatchdogTick(10);
+	// ports a socket worker tries before giving up
+	const int MaxListenAttempts = 8;
+
+	// Parses a decimal number that must make up all of text and lie in
+	//	[min, max]. Message attributes come from whatever reached the
+	//	port, so anything else is refused rather than thrown on.
+	bool parseNumber(const string& text, long long min, long long max, long long& value)
+	{
+		if (text.empty())
+			return false;
+		errno = 0;
+		char* end = nullptr;
+		long long parsed = std::strtoll(text.c_str(), &end, 10);
+		if (errno != 0 || *end != '\0' || parsed < min || parsed > max)
+			return false;
+		value = parsed;
+		return true;
+	}
+
+	// the most tests an agent may ask for in one message
+	const long long MaxPull = 1 << 20;
+}
+
+TestHarness::TestHarness(Logging* log) : logging(log) {
+	setWorkerCount(0);
+}
+
+TestHarness::TestHarness(Logging* log, vector<ITest*> tst, ExecutionMode mode, size_t workers) : logging(log), tests(tst) {
+	setWorkerCount(workers);
+	run(mode);
+}
+
+void TestHarness::run(ExecutionMode executionMode)
+{
+	mode = executionMode;
+	TestResult::anchorClock();
+
+	// the run sees only tests without cached results
+	bool cached = !resultCacheFile.empty() && mode != ExecutionMode::DISTRIBUTED;
+	vector<ITest*> suite;
+	if (cached)
+	{
+		suite = tests;
+		tests = skipCached();
+	}
+
+	if (mode == ExecutionMode::IN_PROCESS)
+		runInProcess();
+	else if (mode == ExecutionMode::PROCESSES)
+		runInProcesses();
+	else if (mode == ExecutionMode::DISTRIBUTED)
+		runDistributed();
+	else
+		runOverSockets();
+
+	if (cached)
+	{
+		tests.swap(suite);
+		resultCache.save(resultCacheFile);
+		cacheKeys.clear();
+	}
+	logging->Flush();
+}
+
+void TestHarness::setWorkerCount(size_t count)
+{
+	if (count == 0)
+		count = std::thread::hardware_concurrency();
+	if (count == 0)
+		count = 2;
+
+	std::lock_guard<std::mutex> lock(workersMtx);
+	workerCount = count;
+	if (running)
+		startWorkers();
+}
+
+size_t TestHarness::getWorkerCount() const
+{
+	return workerCount;
+}
+
+void TestHarness::setHistoryFile(const string& path)
+{
+	historyFile = path;
+}
 
-TestHarness::TestHarness(Logging* log, vector<ITest*> tst) : logging(log), tests(tst) {
+void TestHarness::setResultCacheFile(const string& path)
+{
+	resultCacheFile = path;
+}
+
+void TestHarness::setForceRun(bool force)
+{
+	forceRun = force;
+}
+
+void TestHarness::setTestTimeout(std::chrono::milliseconds limit)
+{
+	testTimeout = limit;
+}
+
+void TestHarness::setRunTimeout(std::chrono::milliseconds limit)
+{
+	runTimeout = limit;
+}
+
+void TestHarness::setPortRange(int first, int last)
+{
+	if (first < 1 || last > 65535 || first > last)
+		return;
+	std::lock_guard<std::mutex> lock(portsMtx);
+	firstPort = first;
+	lastPort = last;
+	portCursor = first;
+}
+
+int TestHarness::acquirePort()
+{
+	std::lock_guard<std::mutex> lock(portsMtx);
+	if (portCursor < firstPort || portCursor > lastPort)
+		portCursor = firstPort;
+	for (int x = firstPort; x <= lastPort; x++)
+	{
+		int port = portCursor;
+		portCursor = portCursor == lastPort ? firstPort : portCursor + 1;
+		if (portsInUse.insert(port).second)
+			return port;
+	}
+	return -1;
+}
 
-	// for demonstration, create a queue of ints that will be used 
-	//	make each test sleep to demonstrate that the tests are running
-	//	in parallel
-	for (auto x : { 4,1,2,3,5,4,3,3,3,3,1,6 })sleepTimes.enQ(x);
+void TestHarness::releasePort(int port)
+{
+	std::lock_guard<std::mutex> lock(portsMtx);
+	portsInUse.erase(port);
+}
+
+void TestHarness::setCoordinator(const EndPoint& ep)
+{
+	coordinatorEP = ep;
+}
+
+vector<double> TestHarness::predictDurations()
+{
+	if (historyFile.empty() || !history.load(historyFile))
+		return {};
+
+	vector<double> predicted(tests.size());
+	double total = 0;
+	size_t known = 0;
+	for (size_t x = 0; x < tests.size(); x++)
+	{
+		predicted[x] = history.estimate(tests[x]->getTestName());
+		if (predicted[x] >= 0)
+		{
+			total += predicted[x];
+			known++;
+		}
+	}
+	if (known == 0)
+		return {};
+
+	for (auto& seconds : predicted)
+		if (seconds < 0)
+			seconds = total / known;
+	return predicted;
+}
+
+vector<int> TestHarness::longestFirstOrder(const vector<double>& predicted)
+{
+	vector<int> order(tests.size());
+	for (int x = 0; x < (int)tests.size(); x++)
+		order[x] = x;
+	if (!predicted.empty())
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return predicted[a] > predicted[b]; });
+	return order;
+}
+
+void TestHarness::saveHistory()
+{
+	if (historyFile.empty())
+		return;
+	for (size_t x = 0; x < tests.size(); x++)
+		if (measured[x] >= 0)
+			history.record(tests[x]->getTestName(), measured[x]);
+	history.save(historyFile);
+}
+
+vector<ITest*> TestHarness::skipCached()
+{
+	resultCache.load(resultCacheFile);
+	cacheKeys.clear();
+
+	// a result only carries its test's name, so a name shared by two
+	//	tests can't say which one passed
+	std::unordered_map<string, size_t> nameCounts;
+	for (auto test : tests)
+		nameCounts[test->getTestName()]++;
+
+	vector<ITest*> uncached;
+	for (auto test : tests)
+	{
+		size_t& sharing = nameCounts[test->getTestName()];
+		if (sharing > 1)
+		{
+			cout << "Not caching results of tests named \"" << test->getTestName() << "\": " << sharing << " tests share the name" << endl;
+			sharing = 0;  // warn once; any count but 1 is a shared name
+		}
+		if (sharing != 1)
+		{
+			uncached.push_back(test);
+			continue;
+		}
+
+		auto module = testModules.find(test);
+		string digest = resultCache.moduleDigest(module == testModules.end() ? "" : module->second);
+		// without a digest there's no telling whether the test changed
+		if (digest.empty())
+		{
+			uncached.push_back(test);
+			continue;
+		}
+		unsigned long long key = ResultCache::key(digest, test->getTestName(), test->getInputs());
+		cacheKeys[test->getTestName()] = key;
+
+		TestResult result;
+		if (!forceRun && resultCache.lookup(key, result) && result.getIsSuccessful())
+		{
+			result.setIsCached(true);
+			log(result);
+		}
+		else
+			uncached.push_back(test);
+	}
+	return uncached;
+}
+
+void TestHarness::startWorkers()
+{
+	while (liveWorkers < workerCount)
+	{
+		auto state = std::make_shared<WorkerState>();
+		if (mode == ExecutionMode::IN_PROCESS)
+			state->thread = thread(&TestHarness::workerThread, this, scheduler->addWorker(), state);
+		else
+		{
+			int port = acquirePort();
+			if (port < 0)
+				break;
+			state->thread = thread(&TestHarness::childThread, this, port, state);
+		}
+		++liveWorkers;
+		workers.push_back(state);
+	}
+}
+
+void TestHarness::checkTimeouts(bool runExpired)
+{
+	auto now = steady_clock::now();
+	for (size_t x = 0; x < workers.size(); x++)
+	{
+		auto state = workers[x];
+		long long status = state->status;
+		if (status < 0)
+			continue;
+		int testId = (int)(status / 2);
+		auto elapsed = now - steady_clock::time_point(steady_clock::duration(state->started));
+
+		if (status % 2 == 0)
+		{
+			// report and cancel a test that is over its limit
+			auto limit = tests[testId]->getTimeout().count() > 0 ? tests[testId]->getTimeout() : testTimeout;
+			if (!runExpired && (limit.count() == 0 || elapsed <= limit))
+				continue;
+			if (!state->status.compare_exchange_strong(status, status + 1))
+				continue;
+			state->cancelled = now;
+			tests[testId]->getCancellationToken().cancel();
+			measured[testId] = std::chrono::duration<double>(elapsed).count();
+			string ms = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+			if (limit.count() > 0 && elapsed > limit)
+				reportFailure(testId, "Test timed out after " + ms + " ms");
+			else
+				reportFailure(testId, "Test stopped after " + ms + " ms: run timed out");
+		}
+		else if (now - state->cancelled > CancelGrace)
+		{
+			// the test ignored cancellation; leave it running on a thread
+			//	nobody waits for and put a fresh worker in its place
+			if (!state->status.compare_exchange_strong(status, WorkerState::ABANDONED))
+				continue;
+			state->thread.detach();
+			workers.erase(workers.begin() + x--);
+			--liveWorkers;
+			for (size_t y = state->next; y < state->chunk.size(); y++)
+				testIds.enQ(state->chunk[y]);
+			if (!runExpired)
+				startWorkers();
+		}
+	}
+}
+
+void TestHarness::reportFailure(int testId, const string& message)
+{
+	TestResult result;
+	result.setTestName(tests[testId]->getTestName());
+	result.setIsSuccessful(false);
+	result.setMessage(message);
+	log(result);
+	++reportedCount;
+}
+
+void TestHarness::beginTest(WorkerState& state, int testId)
+{
+	tests[testId]->getCancellationToken().reset();
+	state.started = steady_clock::now().time_since_epoch().count();
+	state.status = 2LL * testId;
+}
+
+bool TestHarness::finishTest(WorkerState& state, int testId, TestResult& result, bool completed)
+{
+	// nobody else has touched this test: report it
+	long long status = 2LL * testId;
+	if (state.status.compare_exchange_strong(status, WorkerState::IDLE))
+	{
+		measured[testId] = completed ? result.getFunctionExecutionTime() : -1;
+		log(result);
+		++reportedCount;
+		return true;
+	}
 
+	// the watchdog reported it as timed out; carry on unless the
+	//	watchdog has also given up on this worker
+	status = 2LL * testId + 1;
+	return state.status.compare_exchange_strong(status, WorkerState::IDLE);
+}
+
+void TestHarness::workerDone(WorkerState& state)
+{
+	{
+		std::lock_guard<std::mutex> lock(workersMtx);
+		state.done = true;
+	}
+	workersCv.notify_all();
+}
+
+bool TestHarness::retireWorker()
+{
+	size_t live = liveWorkers;
+	while (live > workerCount)
+	{
+		if (liveWorkers.compare_exchange_weak(live, live - 1))
+			return true;
+	}
+	return false;
+}
+
+void TestHarness::runInProcess()
+{
+	// with history, seed workers longest first so no long test is left
+	//	for the end of the run; otherwise each worker starts on its own
+	//	contiguous chunk of tests
+	vector<double> predicted = predictDurations();
+	double predictedMakespan = 0;
+	WorkStealingScheduler stealing = predicted.empty()
+		? WorkStealingScheduler(tests.size(), workerCount)
+		: WorkStealingScheduler(WorkStealingScheduler::longestFirst(predicted, workerCount, predictedMakespan));
+	measured.assign(tests.size(), -1);
+	auto start = steady_clock::now();
+	bool runExpired = false;
+
+	std::unique_lock<std::mutex> lock(workersMtx);
+	scheduler = &stealing;
+	running = true;
+	startWorkers();
+
+	// this thread is the watchdog while the run lasts; workers may still
+	//	be joining while we wait, so keep collecting threads until none
+	//	are left
+	while (true)
+	{
+		for (auto iter = workers.begin(); iter != workers.end();)
+		{
+			if ((*iter)->done)
+			{
+				(*iter)->thread.join();
+				iter = workers.erase(iter);
+			}
+			else
+				++iter;
+		}
+		if (workers.empty())
+			break;
+
+		if (runTimeout.count() > 0 && !runExpired && steady_clock::now() - start > runTimeout)
+		{
+			runExpired = true;
+			for (int testId : scheduler->drain())
+				reportFailure(testId, "Test not run: run timed out");
+		}
+		checkTimeouts(runExpired);
+		workersCv.wait_for(lock, WatchdogTick);
+	}
+	running = false;
+	scheduler = nullptr;
+	lock.unlock();
+
+	double makespan = std::chrono::duration<double>(steady_clock::now() - start).count();
+	saveHistory();
+	logging->Flush();
+	if (!predicted.empty())
+		cout << "Makespan: predicted " << predictedMakespan << " sec(s), actual " << makespan << " sec(s)" << endl;
+}
+
+// runs tests from the scheduler until none are left; anything left in
+//	this worker's deque when it retires is stolen by the others
+void TestHarness::workerThread(size_t slot, std::shared_ptr<WorkerState> state)
+{
+	while (true)
+	{
+		int testId = scheduler->next(slot);
+		if (testId < 0)
+		{
+			--liveWorkers;
+			break;
+		}
+
+		TestResult result;
+		beginTest(*state, testId);
+		bool completed = executeTest(tests[testId], result);
+		// abandoned: the run has moved on without this thread
+		if (!finishTest(*state, testId, result, completed))
+			return;
+
+		if (retireWorker())
+			break;
+	}
+	workerDone(*state);
+}
+
+#ifdef _WIN32
+
+void TestHarness::runInProcesses()
+{
+	cout << "Worker processes are not supported on this platform; running tests in process" << endl;
+	mode = ExecutionMode::IN_PROCESS;
+	runInProcess();
+}
+
+void TestHarness::childProcess(int, int) {}
+
+#else
+
+namespace
+{
+	// reads exactly size bytes unless the other end closes
+	bool readAll(int fd, void* dst, size_t size)
+	{
+		char* p = static_cast<char*>(dst);
+		while (size > 0)
+		{
+			ssize_t got = ::read(fd, p, size);
+			if (got < 0 && errno == EINTR)
+				continue;
+			if (got <= 0)
+				return false;
+			p += got;
+			size -= got;
+		}
+		return true;
+	}
+
+	/**
+	* Forks worker processes on request. The zygote is forked when a run
+	* starts, before the harness creates any threads for it, so workers
+	* forked from it later never inherit a lock some other thread held.
+	**/
+	struct Zygote
+	{
+		pid_t pid = -1;
+		// the harness writes the port of each worker to start
+		int spawnFd = -1;
+		// the zygote writes (port, wait status) as each worker exits
+		int exitFd = -1;
+	};
+
+	// written to by the zygote's SIGCHLD handler so poll wakes as soon
+	//	as a worker exits
+	int childExitPipe[2];
+
+	void onChildExit(int)
+	{
+		int saved = errno;
+		char byte = 0;
+		if (::write(childExitPipe[1], &byte, 1) < 0) {}
+		errno = saved;
+	}
+
+	Zygote startZygote(std::function<void(int)> workerMain)
+	{
+		int spawnPipe[2], exitPipe[2];
+		Zygote zygote;
+		if (::pipe(spawnPipe) != 0)
+			return zygote;
+		if (::pipe(exitPipe) != 0)
+		{
+			::close(spawnPipe[0]);
+			::close(spawnPipe[1]);
+			return zygote;
+		}
+
+		// don't let buffered output be written twice
+		cout.flush();
+		::fflush(stdout);
+
+		zygote.pid = ::fork();
+		if (zygote.pid != 0)
+		{
+			::close(spawnPipe[0]);
+			::close(exitPipe[1]);
+			zygote.spawnFd = spawnPipe[1];
+			zygote.exitFd = exitPipe[0];
+			return zygote;
+		}
+
+		// in the zygote
+		::close(spawnPipe[1]);
+		::close(exitPipe[0]);
+		if (::pipe(childExitPipe) == 0)
+		{
+			::fcntl(childExitPipe[0], F_SETFL, O_NONBLOCK);
+			::fcntl(childExitPipe[1], F_SETFL, O_NONBLOCK);
+			struct sigaction action = {};
+			action.sa_handler = onChildExit;
+			action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+			::sigaction(SIGCHLD, &action, nullptr);
+		}
+		std::map<pid_t, int> ports;
+		bool open = true;
+		while (open || !ports.empty())
+		{
+			if (open)
+			{
+				pollfd pfds[2] = { { spawnPipe[0], POLLIN, 0 }, { childExitPipe[0], POLLIN, 0 } };
+				int port;
+				char drain[64];
+				// the timeout only matters if the self-pipe couldn't be made
+				if (::poll(pfds, 2, 10) > 0 && (pfds[1].revents & POLLIN))
+					while (::read(childExitPipe[0], drain, sizeof(drain)) > 0) {}
+				if (pfds[0].revents & (POLLIN | POLLHUP))
+				{
+					if (!readAll(spawnPipe[0], &port, sizeof(port)))
+						open = false;
+					else
+					{
+						pid_t pid = ::fork();
+						if (pid == 0)
+						{
+							::signal(SIGCHLD, SIG_DFL);
+							::close(childExitPipe[0]);
+							::close(childExitPipe[1]);
+							::close(spawnPipe[0]);
+							::close(exitPipe[1]);
+							workerMain(port);
+							::_exit(0);
+						}
+						if (pid > 0)
+							ports[pid] = port;
+					}
+				}
+			}
+
+			// once the harness hangs up every test has been reported, so
+			//	stop the workers and wait for them
+			if (!open)
+				for (auto& entry : ports)
+					::kill(entry.first, SIGKILL);
+			int status;
+			pid_t pid;
+			while (!ports.empty() && (pid = ::waitpid(-1, &status, open ? WNOHANG : 0)) > 0)
+			{
+				int record[2] = { ports[pid], status };
+				ports.erase(pid);
+				if (::write(exitPipe[1], record, sizeof(record)) != sizeof(record))
+					break;
+			}
+		}
+		::_exit(0);
+	}
+
+	string describeExit(int status)
+	{
+		if (WIFSIGNALED(status))
+			return "Test crashed: signal " + std::to_string(WTERMSIG(status)) + " (" + ::strsignal(WTERMSIG(status)) + ")";
+		return "Test process exited with code " + std::to_string(WEXITSTATUS(status));
+	}
+}
+
+void TestHarness::runInProcesses()
+{
+	vector<double> predicted = predictDurations();
+	vector<int> order = longestFirstOrder(predicted);
+	measured.assign(tests.size(), -1);
+	auto start = steady_clock::now();
+
+	// the zygote is forked from this process, so nothing logged may be
+	//	left unwritten
+	logging->Flush();
+	SocketSystem ss;
+
+	// the zygote has to be forked before the coordinator's threads start,
+	//	so a port another process holds means starting both again on the
+	//	next free one
+	int coordinatorPort = -1;
+	Zygote zygote;
+	std::unique_ptr<Comm> coordinator;
+	for (int attempt = 1; attempt <= MaxListenAttempts; attempt++)
+	{
+		int next = acquirePort();
+		if (coordinatorPort >= 0)
+			releasePort(coordinatorPort);
+		coordinatorPort = next;
+		if (coordinatorPort < 0)
+			break;
+		zygote = startZygote([this, coordinatorPort](int port) { childProcess(port, coordinatorPort); });
+		if (zygote.pid < 0)
+		{
+			cout << "Can't fork worker processes; running tests in process" << endl;
+			releasePort(coordinatorPort);
+			runInProcess();
+			return;
+		}
+		coordinator.reset(new Comm(EndPoint("localhost", coordinatorPort), "coordinator"));
+		if (coordinator->start())
+			break;
+		coordinator.reset();
+		cout << "Can't listen on port " << coordinatorPort << endl;
+		::close(zygote.spawnFd);
+		::close(zygote.exitFd);
+		::waitpid(zygote.pid, nullptr, 0);
+	}
+	if (!coordinator)
+	{
+		cout << "No free port for worker processes; running tests in process" << endl;
+		if (coordinatorPort >= 0)
+			releasePort(coordinatorPort);
+		runInProcess();
+		return;
+	}
+	Comm& comm = *coordinator;
+	EndPoint coordinatorEP("localhost", coordinatorPort);
+
+	// turn worker exits, and watchdog ticks when there are time limits,
+	//	into messages so the loop below is the only place that acts on them
+	bool timed = testTimeout.count() > 0 || runTimeout.count() > 0;
+	for (auto test : tests)
+		timed = timed || test->getTimeout().count() > 0;
+	thread reaper([&]() {
+		while (true)
+		{
+			pollfd pfd = { zygote.exitFd, POLLIN, 0 };
+			int ready = ::poll(&pfd, 1, (int)(10 * WatchdogTick.count()));
+			Message msg(coordinatorEP, coordinatorEP);
+			int record[2];
+			if (ready == 0 && timed)
+				msg.name("tick");
+			else if (ready == 0 || (ready < 0 && errno == EINTR))
+				continue;
+			else if (readAll(zygote.exitFd, record, sizeof(record)))
+			{
+				msg.name("exited");
+				msg.attribute("port", std::to_string(record[0]));
+				msg.attribute("status", std::to_string(record[1]));
+			}
+			else
+				break;
+			comm.postMessage(msg);
+		}
+	});
+
+	struct Worker
+	{
+		int pid = 0;
+		int testId = -1;
+		steady_clock::time_point started;
+	};
+	std::map<int, Worker> pool;      // by port, including workers still starting
+	std::deque<int> idle;            // ports of workers waiting for a test
+	vector<int> unusable;            // ports whose worker exited before it was ready
+	size_t nextTest = 0, reported = 0, busy = 0;
+	bool runExpired = false;
+
+	auto fail = [&](int testId, const string& message) {
+		reportFailure(testId, message);
+		reported++;
+	};
+	auto spawn = [&]() {
+		int port = acquirePort();
+		if (port < 0)
+			return false;
+		pool[port];
+		if (::write(zygote.spawnFd, &port, sizeof(port)) == sizeof(port))
+			return true;
+		pool.erase(port);
+		releasePort(port);
+		return false;
+	};
+	// keep a warm spare or two beyond the workers in use
+	auto topUp = [&]() {
+		size_t spares = std::max<size_t>(1, workerCount / 4);
+		while (reported < tests.size() && pool.size() < workerCount + spares)
+			if (!spawn())
+				break;
+		// no worker and no way to start one
+		if (pool.empty())
+			for (; nextTest < order.size(); nextTest++)
+				fail(order[nextTest], "Test not run: no worker process could start");
+	};
+	auto dispatch = [&]() {
+		while (busy < workerCount && !idle.empty() && nextTest < order.size())
+		{
+			int port = idle.front();
+			idle.pop_front();
+			Worker& worker = pool[port];
+			worker.testId = order[nextTest++];
+			worker.started = steady_clock::now();
+			busy++;
+
+			Message msg(EndPoint("localhost", port), coordinatorEP);
+			msg.name("runtest");
+			msg.body(std::to_string(worker.testId));
+			comm.postMessage(msg);
+		}
+	};
+
+	topUp();
+	while (reported < tests.size())
+	{
+		Message msg = comm.getMessage();
+		int port = (int)msg.from().port;
+		// only workers this run spawned are listened to
+		auto sender = pool.find(port);
+		long long number = 0;
+
+		if (msg.name() == "ready")
+		{
+			if (sender != pool.end() && parseNumber(msg.attribute("pid"), 1, INT_MAX, number))
+			{
+				sender->second.pid = (int)number;
+				idle.push_back(port);
+			}
+		}
+		else if (msg.name() == "result")
+		{
+			// a result for a test already reported as timed out is dropped
+			TestResult result;
+			if (sender != pool.end() && parseNumber(msg.attribute("testId"), 0, (long long)tests.size() - 1, number) &&
+				sender->second.testId == (int)number && result.deserialize(msg.body()))
+			{
+				Worker& worker = sender->second;
+				if (msg.attribute("completed") == "1")
+					measured[worker.testId] = result.getFunctionExecutionTime();
+				log(result);
+				reported++;
+				worker.testId = -1;
+				busy--;
+				idle.push_back(port);
+			}
+		}
+		else if (msg.name() == "exited")
+		{
+			long long status = 0;
+			auto iter = pool.end();
+			if (parseNumber(msg.attribute("port"), 0, INT_MAX, number) && parseNumber(msg.attribute("status"), INT_MIN, INT_MAX, status))
+				iter = pool.find((int)number);
+			if (iter != pool.end())
+			{
+				port = (int)number;
+				if (iter->second.testId >= 0)
+				{
+					fail(iter->second.testId, describeExit((int)status));
+					busy--;
+				}
+				else if (iter->second.pid < 0)
+					busy--;  // killed by the watchdog, already reported
+				// one that never got going probably couldn't bind its port;
+				//	keep the port out of use until the run ends
+				if (iter->second.pid == 0)
+					unusable.push_back(port);
+				else
+					releasePort(port);
+				pool.erase(iter);
+				idle.erase(std::remove(idle.begin(), idle.end(), port), idle.end());
+			}
+		}
+		else if (msg.name() == "tick")
+		{
+			auto now = steady_clock::now();
+			if (runTimeout.count() > 0 && !runExpired && now - start > runTimeout)
+			{
+				runExpired = true;
+				for (; nextTest < order.size(); nextTest++)
+					fail(order[nextTest], "Test not run: run timed out");
+			}
+			// a worker process can be stopped outright, so there is no grace
+			//	period; its exit is reported but not counted twice
+			for (auto& entry : pool)
+			{
+				Worker& worker = entry.second;
+				if (worker.testId < 0)
+					continue;
+				auto limit = tests[worker.testId]->getTimeout().count() > 0 ? tests[worker.testId]->getTimeout() : testTimeout;
+				auto elapsed = now - worker.started;
+				string ms = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+				if (limit.count() > 0 && elapsed > limit)
+					fail(worker.testId, "Test timed out after " + ms + " ms");
+				else if (runExpired)
+					fail(worker.testId, "Test stopped after " + ms + " ms: run timed out");
+				else
+					continue;
+				measured[worker.testId] = std::chrono::duration<double>(elapsed).count();
+				::kill(worker.pid, SIGKILL);
+				worker.testId = -1;
+				worker.pid = -1;
+			}
+		}
+		topUp();
+		dispatch();
+	}
+
+	// hanging up on the zygote stops it and the workers
+	::close(zygote.spawnFd);
+	reaper.join();
+	::close(zygote.exitFd);
+	::waitpid(zygote.pid, nullptr, 0);
+	comm.stop();
+	for (auto& entry : pool)
+		releasePort(entry.first);
+	for (int port : unusable)
+		releasePort(port);
+	releasePort(coordinatorPort);
+
+	double makespan = std::chrono::duration<double>(steady_clock::now() - start).count();
+	saveHistory();
+	logging->Flush();
+	if (!predicted.empty())
+		cout << "Makespan: actual " << makespan << " sec(s)" << endl;
+}
+
+void TestHarness::childProcess(int port, int coordinatorPort)
+{
+	EndPoint coordinatorEP("localhost", coordinatorPort);
+	EndPoint childEP("localhost", port);
+	Comm childComm(childEP, "worker");
+	// the harness sees the exit and starts a worker on another port
+	if (!childComm.start())
+		return;
+
+	Message msg(coordinatorEP, childEP);
+	msg.name("ready");
+	msg.attribute("pid", std::to_string(::getpid()));
+	childComm.postMessage(msg);
+
+	// runs until the zygote stops it
+	while (true)
+	{
+		msg = childComm.getMessage();
+		long long testId = 0;
+		if (!parseNumber(msg.body(), 0, (long long)tests.size() - 1, testId))
+			continue;
+		TestResult result;
+		bool completed = executeTest(tests[testId], result);
+
+		Message reply(coordinatorEP, childEP);
+		reply.name("result");
+		reply.attribute("testId", std::to_string(testId));
+		reply.attribute("completed", completed ? "1" : "0");
+		reply.body(result.serialize());
+		childComm.postMessage(reply);
+	}
+}
+
+#endif
+
+namespace
+{
+	// agents send a heartbeat this often, and are dropped after missing
+	//	several in a row
+	const std::chrono::milliseconds HeartbeatPeriod(1000);
+	// an agent repeats its registration this often until the coordinator
+	//	answers, so agents may start first
+	const std::chrono::milliseconds RegisterRetry(100);
+	const int MissedHeartbeats = 5;
+}
+
+void TestHarness::runDistributed()
+{
+	vector<double> predicted = predictDurations();
+	vector<int> order = longestFirstOrder(predicted);
+	measured.assign(tests.size(), -1);
+	auto start = steady_clock::now();
+
+	SocketSystem ss;
+	Comm comm(coordinatorEP, "coordinator");
+	if (!comm.start())
+	{
+		for (size_t x = 0; x < tests.size(); x++)
+			reportFailure((int)x, "Test not run: can't listen on " + coordinatorEP.toString());
+		return;
+	}
+
+	// wakes the loop below so silent agents are noticed
+	std::mutex finishedMtx;
+	std::condition_variable finishedCv;
+	bool finished = false;
+	thread ticker([&]() {
+		std::unique_lock<std::mutex> lock(finishedMtx);
+		while (!finishedCv.wait_for(lock, HeartbeatPeriod, [&]() { return finished; }))
+		{
+			Message msg(coordinatorEP, coordinatorEP);
+			msg.name("tick");
+			comm.postMessage(msg);
+		}
+	});
+
+	struct Agent
+	{
+		EndPoint ep;
+		// number of tests the agent has asked for and not yet been sent
+		size_t credit = 0;
+		// tests sent to the agent without a result yet
+		std::set<int> running;
+		steady_clock::time_point lastHeard;
+	};
+	std::map<string, Agent> agents;
+	std::deque<int> pending(order.begin(), order.end());
+	size_t reported = 0;
+
+	auto serve = [&](Agent& agent) {
+		string chunk;
+		while (agent.credit > 0 && !pending.empty())
+		{
+			int testId = pending.front();
+			pending.pop_front();
+			agent.running.insert(testId);
+			agent.credit--;
+			if (!chunk.empty())
+				chunk += ",";
+			chunk += std::to_string(testId);
+		}
+		if (chunk.empty())
+			return;
+		Message msg(agent.ep, coordinatorEP);
+		msg.name("runtest");
+		msg.body(chunk);
+		comm.postMessage(msg);
+	};
+	// an agent that went silent gives its tests back
+	auto drop = [&](std::map<string, Agent>::iterator iter) {
+		for (auto testId = iter->second.running.rbegin(); testId != iter->second.running.rend(); ++testId)
+			pending.push_front(*testId);
+		agents.erase(iter);
+	};
+	auto dismiss = [&](const EndPoint& ep, const string& reason) {
+		Message msg(ep, coordinatorEP);
+		msg.name("done");
+		msg.body(reason);
+		comm.postMessage(msg);
+	};
+
+	while (reported < tests.size())
+	{
+		Message msg = comm.getMessage();
+		string key = msg.from().toString();
+		auto iter = agents.find(key);
+		auto now = steady_clock::now();
+
+		if (msg.name() == "register")
+		{
+			long long agentTests = 0, pull = 0;
+			if (!parseNumber(msg.attribute("tests"), 0, LLONG_MAX, agentTests) || !parseNumber(msg.attribute("pull"), 0, MaxPull, pull))
+				dismiss(msg.from(), "malformed registration");
+			else if ((size_t)agentTests != tests.size())
+				dismiss(msg.from(), "agent has " + msg.attribute("tests") + " tests, coordinator has " + std::to_string(tests.size()));
+			else if (iter == agents.end())
+			{
+				Agent& agent = agents[key];
+				agent.ep = msg.from();
+				agent.credit = (size_t)pull;
+				agent.lastHeard = now;
+			}
+			else
+				iter->second.lastHeard = now;
+		}
+		else if (msg.name() == "tick")
+		{
+			for (auto agent = agents.begin(); agent != agents.end();)
+			{
+				if (now - agent->second.lastHeard > MissedHeartbeats * HeartbeatPeriod)
+					drop(agent++);
+				else
+					++agent;
+			}
+		}
+		else if (iter == agents.end())
+		{
+			// not registered, or dropped for going silent
+			dismiss(msg.from(), "not registered");
+		}
+		else
+		{
+			Agent& agent = iter->second;
+			agent.lastHeard = now;
+			long long testId = 0, pull = 0;
+			// a result naming no test this agent holds is dropped
+			if (msg.name() == "result" && parseNumber(msg.attribute("testId"), 0, (long long)tests.size() - 1, testId))
+			{
+				TestResult result;
+				if (agent.running.erase((int)testId))
+				{
+					if (result.deserialize(msg.body()))
+					{
+						if (msg.attribute("completed") == "1")
+							measured[testId] = result.getFunctionExecutionTime();
+						log(result);
+						reported++;
+					}
+					else
+						pending.push_front((int)testId);  // garbled; run it again
+				}
+				// a missing or bad pull asks for nothing more
+				if (parseNumber(msg.attribute("pull"), 0, MaxPull, pull))
+					agent.credit += (size_t)pull;
+			}
+		}
+
+		for (auto& agent : agents)
+			serve(agent.second);
+	}
+
+	for (auto& agent : agents)
+		dismiss(agent.second.ep, "");
+	{
+		std::lock_guard<std::mutex> lock(finishedMtx);
+		finished = true;
+	}
+	finishedCv.notify_all();
+	ticker.join();
+	comm.stop();
+
+	double makespan = std::chrono::duration<double>(steady_clock::now() - start).count();
+	saveHistory();
+	logging->Flush();
+	if (!predicted.empty())
+		cout << "Makespan: actual " << makespan << " sec(s)" << endl;
+}
+
+void TestHarness::runAgent(const EndPoint& coordinator, const EndPoint& self, size_t slots)
+{
+	if (slots == 0)
+		slots = workerCount;
+
+	SocketSystem ss;
+	Comm comm(self, "agent");
+	if (!comm.start())
+	{
+		cout << "Agent can't listen on " << self.toString() << endl;
+		return;
+	}
+
+	BlockingQueue<int> work;
+	vector<thread> slotThreads;
+	for (size_t x = 0; x < slots; x++)
+		slotThreads.emplace_back([&]() {
+			while (true)
+			{
+				int testId = work.deQ();
+				if (testId < 0)
+					break;
+				TestResult result;
+				bool completed = executeTest(tests[testId], result);
+
+				// each result asks for one more test
+				Message reply(coordinator, self);
+				reply.name("result");
+				reply.attribute("testId", std::to_string(testId));
+				reply.attribute("completed", completed ? "1" : "0");
+				reply.attribute("pull", "1");
+				reply.body(result.serialize());
+				comm.postMessage(reply);
+			}
+		});
+
+	std::mutex doneMtx;
+	std::condition_variable doneCv;
+	bool done = false;
+	std::atomic<bool> registered(false);
+	thread heartbeat([&]() {
+		std::unique_lock<std::mutex> lock(doneMtx);
+		do
+		{
+			Message beat(coordinator, self);
+			if (registered)
+				beat.name("heartbeat");
+			else
+			{
+				// ask for a second test per slot so a slot never waits on a round trip
+				beat.name("register");
+				beat.attribute("tests", std::to_string(tests.size()));
+				beat.attribute("pull", std::to_string(2 * slots));
+			}
+			comm.postMessage(beat);
+		} while (!doneCv.wait_for(lock, registered ? HeartbeatPeriod : RegisterRetry, [&]() { return done; }));
+	});
+
+	while (true)
+	{
+		Message msg = comm.getMessage();
+		registered = true;
+		if (msg.name() == "done")
+		{
+			if (!msg.body().empty())
+				cout << "Agent " << self.toString() << " dismissed: " << msg.body() << endl;
+			break;
+		}
+		if (msg.name() != "runtest")
+			continue;
+
+		const std::string& chunk = msg.body();
+		size_t pos = 0;
+		while (true)
+		{
+			size_t comma = chunk.find(',', pos);
+			long long testId = 0;
+			if (parseNumber(chunk.substr(pos, comma - pos), 0, (long long)tests.size() - 1, testId))
+				work.enQ((int)testId);
+			if (comma == std::string::npos)
+				break;
+			pos = comma + 1;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(doneMtx);
+		done = true;
+	}
+	doneCv.notify_all();
+	heartbeat.join();
+	for (size_t x = 0; x < slots; x++)
+		work.enQ(-1);
+	for (auto& slot : slotThreads)
+		slot.join();
+	comm.stop();
+}
+
+void TestHarness::runOverSockets()
+{
 	SocketSystem ss;
 	EndPoint queueManagerEP("localhost", 9191);
+	EndPoint testManagerEP("localhost", 9193);
+	EndPoint testDispatcherEP("localhost", 9192);
+	Comm queueManagerComm(queueManagerEP, "listener");
+	Comm testManagerComm(testManagerEP, "server");
+	Comm testDispatcherComm(testDispatcherEP, "server");
+
+	// without all three end points no test can be handed out
+	for (auto started : { std::make_pair(&queueManagerComm, queueManagerEP),
+		std::make_pair(&testManagerComm, testManagerEP), std::make_pair(&testDispatcherComm, testDispatcherEP) })
+	{
+		if (started.first->start())
+			continue;
+		queueManagerComm.stop();
+		testManagerComm.stop();
+		testDispatcherComm.stop();
+		for (size_t x = 0; x < tests.size(); x++)
+			reportFailure((int)x, "Test not run: can't listen on " + started.second.toString());
+		return;
+	}
 
 	// create the queue manager thread that will listen for messages
 	//	and add items to the appropriate queue
 	thread queueManager([&]() {
-		Comm queueManagerComm(queueManagerEP, "listener");
-		queueManagerComm.start();
-
 		while (true)
 		{
 			auto msg = queueManagerComm.getMessage();
 
+			if (msg.name() == "stop") // from the dispatcher, once the run is over
+				break;
+			// anything that doesn't parse is dropped
+			long long number = 0;
 			if (msg.name() == "ready") // from child threads
 			{
-				int endPointId = std::stoi(msg.body());
-				ready.enQ(endPointId);
+				if (parseNumber(msg.body(), 1, 65535, number))
+					ready.enQ((int)number);
 			}
-			else if (msg.name() == "testrequest") // from 
+			else if (msg.name() == "testrequest") // from the test manager
 			{
-				int testId = std::stoi(msg.body());
-				testIds.enQ(testId);
+				if (parseNumber(msg.body(), 0, (long long)tests.size() - 1, number))
+					testIds.enQ((int)number);
 			}
 		}
+		queueManagerComm.stop();
 		});
 
 
 	// creates messages for all of the tests that have been requested
 	thread testManager([&]() {
-		EndPoint testManagerEP("localhost", 9193);
-		Comm testManagerComm(testManagerEP, "server");
-		testManagerComm.start();
+		vector<int> order = longestFirstOrder(predictDurations());
 
-		for (int x = 0; x < tests.size(); x++) {
+		for (int x : order) {
 			Message msg;
 			msg.to(queueManagerEP);
 			msg.from(testManagerEP);
@@ -65,80 +1258,235 @@ TestHarness::TestHarness(Logging* log, vector<ITest*> tst) : logging(log), tests
 			msg.body(std::to_string(x));
 			testManagerComm.postMessage(msg);
 		}
+		testManagerComm.stop();
 		});
 
 	// Dequeues threads and tests and sends
 	thread testDispatcher([&]() {
-		EndPoint testDispatcherEP("localhost", 9192);
-		Comm testDispatcherComm(testDispatcherEP, "server");
-		testDispatcherComm.start();
-
 		while (true) {
-			int threadId = ready.deQ(); // portid
-			int testId = testIds.deQ();
+			int threadId = ready.deQ(); // portid; -1 once every child has stopped
+			if (threadId < 0)
+				break;
 
-			// send message to to the thread to run test
 			EndPoint toEP("localhost", threadId);
-
 			Message msg;
 			msg.to(toEP);
 			msg.from(testDispatcherEP);
+
+			// -1 once every test is reported; left on the queue for the
+			//	next child
+			int testId = testIds.deQ();
+			if (testId < 0)
+			{
+				testIds.enQ(testId);
+				msg.name("stop");
+				testDispatcherComm.postMessage(msg);
+				continue;
+			}
+
+			// hand out a share of the waiting tests so short tests don't
+			//	pay a dispatcher round trip each
+			std::string chunk = std::to_string(testId);
+			size_t share = testIds.size() / (2 * workerCount);
+			for (size_t x = 0; x < share && testIds.size() > 0; x++)
+			{
+				testId = testIds.deQ();
+				if (testId < 0)
+				{
+					testIds.enQ(testId);
+					break;
+				}
+				chunk += "," + std::to_string(testId);
+			}
+
+			// send message to to the thread to run test
 			msg.name("runtest");
-			msg.body(std::to_string(testId));
+			msg.body(chunk);
 			testDispatcherComm.postMessage(msg);
 		}
+
+		Message msg;
+		msg.to(queueManagerEP);
+		msg.from(testDispatcherEP);
+		msg.name("stop");
+		testDispatcherComm.postMessage(msg);
+		testDispatcherComm.stop();
 		});
 
 
 	// create the child threads that will run the tests
-	thread child1(&TestHarness::childThread, this, 9194);
-	thread child2(&TestHarness::childThread, this, 9195);
+	measured.assign(tests.size(), -1);
+	claimed.reset(new std::atomic<bool>[tests.size()]);
+	for (size_t x = 0; x < tests.size(); x++)
+		claimed[x] = false;
+	reportedCount = 0;
+	auto start = steady_clock::now();
+	bool runExpired = false;
+	bool finishing = false;
 
+	std::unique_lock<std::mutex> lock(workersMtx);
+	running = true;
+	startWorkers();
 
+	// this thread is the watchdog: it looks for overdue tests, and tests
+	//	held by an abandoned child go back on the test queue. Once every
+	//	test is reported the children are sent "stop", and it waits for
+	//	them to leave.
+	while (true)
+	{
+		for (auto iter = workers.begin(); iter != workers.end();)
+		{
+			if ((*iter)->done)
+			{
+				(*iter)->thread.join();
+				iter = workers.erase(iter);
+			}
+			else
+				++iter;
+		}
+		if (workers.empty())
+			break;
+
+		if (runTimeout.count() > 0 && !runExpired && steady_clock::now() - start > runTimeout)
+		{
+			runExpired = true;
+			for (size_t x = 0; x < tests.size(); x++)
+				if (!claimed[x].exchange(true))
+					reportFailure((int)x, "Test not run: run timed out");
+		}
+		checkTimeouts(runExpired);
+		if (!finishing && reportedCount >= tests.size())
+		{
+			finishing = true;
+			testIds.enQ(-1);
+		}
+		workersCv.wait_for(lock, WatchdogTick);
+	}
+	running = false;
+	lock.unlock();
+
+	// only if every child dropped out
+	for (size_t x = 0; x < tests.size(); x++)
+		if (!claimed[x].exchange(true))
+			reportFailure((int)x, "Test not run: no worker could start");
+
+	ready.enQ(-1);
+	testDispatcher.join();
 	queueManager.join();
 	testManager.join();
-	testDispatcher.join();
-	child1.join();
-	child2.join();
 
+	// leave the queues empty for the next run
+	while (ready.size() > 0)
+		ready.deQ();
+	while (testIds.size() > 0)
+		testIds.deQ();
+	claimed.reset();
+	saveHistory();
 }
 
 // creates a child thread that runs tests
-void TestHarness::childThread(int port) {
+void TestHarness::childThread(int port, std::shared_ptr<WorkerState> state) {
 	EndPoint queueManagerEP("localhost", 9191);
+
+	// a port another process holds is swapped for the next free one; a
+	//	child that finds none drops out and the rest carry the run
+	std::unique_ptr<Comm> childComm;
+	for (int attempt = 1; port >= 0; attempt++)
+	{
+		childComm.reset(new Comm(EndPoint("localhost", port), "server"));
+		if (childComm->start())
+			break;
+		childComm.reset();
+		cout << "Worker can't listen on port " << port << endl;
+		int taken = port;
+		port = attempt < MaxListenAttempts ? acquirePort() : -1;
+		releasePort(taken);
+	}
+	if (!childComm)
+	{
+		--liveWorkers;
+		workerDone(*state);
+		return;
+	}
 	EndPoint childEP("localhost", port);
-	Comm childComm(childEP, "server");
-	childComm.start();
 
 	Message msg;
 	msg.to(queueManagerEP);
 	msg.from(childEP);
 	msg.name("ready");
 	msg.body(std::to_string(port));
-	childComm.postMessage(msg);
+	childComm->postMessage(msg);
 
 	while (true)
 	{
-		msg = childComm.getMessage();
+		msg = childComm->getMessage();
 
-		// get the test id that this thread should run
-		int testId = std::stoi(msg.body());
-		// run the test
-		auto test = tests[testId];
-		runTest(test);
+		if (msg.name() == "stop")
+		{
+			--liveWorkers;
+			workerDone(*state);
+			break;
+		}
+
+		// run each test id in the chunk this thread was sent, skipping
+		//	any that don't parse
+		if (msg.name() != "runtest")
+			continue;
+		const std::string& chunk = msg.body();
+		state->chunk.clear();
+		size_t pos = 0;
+		while (true)
+		{
+			size_t comma = chunk.find(',', pos);
+			long long testId = 0;
+			if (parseNumber(chunk.substr(pos, comma - pos), 0, (long long)tests.size() - 1, testId))
+				state->chunk.push_back((int)testId);
+			if (comma == std::string::npos)
+				break;
+			pos = comma + 1;
+		}
+
+		for (state->next = 0; state->next < state->chunk.size();)
+		{
+			int testId = state->chunk[state->next++];
+			// already reported as not run
+			if (claimed[testId].exchange(true))
+				continue;
+			TestResult result;
+			beginTest(*state, testId);
+			bool completed = executeTest(tests[testId], result);
+			// abandoned: the rest of the chunk was handed to another child
+			if (!finishTest(*state, testId, result, completed))
+			{
+				// the harness may be gone, so the port isn't given back
+				childComm->stop();
+				return;
+			}
+		}
+
+		// leave without asking for more work
+		if (retireWorker())
+		{
+			workerDone(*state);
+			break;
+		}
 
 		// Send a message back to the queue manager that the thread is ready 
 		msg.to(queueManagerEP);
 		msg.from(childEP);
 		msg.name("ready");
 		msg.body(std::to_string(port));
-		childComm.postMessage(msg);
+		childComm->postMessage(msg);
 	}
+	childComm->stop();
+	releasePort(port);
 }
 
 
 TestHarness::~TestHarness() {
-	// Delete logging since it was created with the new operator
+	// Delete logging since it was created with the new operator, once
+	//	the results it holds have been written
+	logging->Flush();
 	delete logging;
 }
 
@@ -147,6 +1495,7 @@ void TestHarness::runTestSequence()
 	// Iterate through the test container.
 	for (auto test : tests)
 		runTest(test);
+	logging->Flush();
 }
 
 void TestHarness::addTest(ITest* test)
@@ -154,17 +1503,42 @@ void TestHarness::addTest(ITest* test)
 	tests.push_back(test);
 }
 
+void TestHarness::addLibrary(const string& path)
+{
+	for (ITest* test : TestLibraries::instance().load(path))
+	{
+		tests.push_back(test);
+		testModules[test] = path;
+	}
+}
+
 
 void TestHarness::log(TestResult result)
 {
+	// passing results are kept for later runs
+	if (!cacheKeys.empty() && result.getIsSuccessful() && !result.getIsCached())
+	{
+		auto key = cacheKeys.find(result.getTestName());
+		if (key != cacheKeys.end())
+			resultCache.store(key->second, result);
+	}
+
 	// Appropriate log level functionality is invoked polymorphically.
 	logging->DisplayResult(result);
 }
 
-void TestHarness::runTest(ITest* test)
+double TestHarness::runTest(ITest* test)
 {
 	TestResult result;
+	bool completed = executeTest(test, result);
+
+	// Log result to console.
+	log(result);
+	return completed ? result.getFunctionExecutionTime() : -1;
+}
 
+bool TestHarness::executeTest(ITest* test, TestResult& result)
+{
 	try
 	{
 		// Set the test name
@@ -173,13 +1547,6 @@ void TestHarness::runTest(ITest* test)
 		// Record start time and date.
 		result.recordStartTime();
 
-
-		// TODO - remove; make the test sleep a random amount of time
-		int x = sleepTimes.deQ();
-		cout << "Run test, Sleep for " << x << endl;
-		std::this_thread::sleep_for(std::chrono::seconds(x));
-
-
 		// Run test and record results.
 		result.setIsSuccessful(test->run());
 		// Record end time and date.
@@ -190,23 +1557,327 @@ void TestHarness::runTest(ITest* test)
 			result.setMessage("Test successful");
 		else
 			result.setMessage(test->getErrorMessage());
-
-		// Log result to console.
-		log(result);
+		string details = test->getDetails();
+		if (!details.empty())
+			result.setMessage(result.getMessage() + "\n" + details);
+		return true;
 	}
 	catch (std::exception &e)
 	{
-		// Exception has been thrown. Set test as unsuccessful, set exception message, and log results to console.
+		// Exception has been thrown. Set test as unsuccessful and set exception message.
+		result.recordEndTime();
 		result.setIsSuccessful(false);
 		result.setMessage("Test threw exception: ");
-		log(result);
 	}
 	catch (...) {
-		// Exception has been thrown. Set test as unsuccessful, set exception message, and log results to console.
+		// Exception has been thrown. Set test as unsuccessful and set exception message.
+		result.recordEndTime();
 		result.setIsSuccessful(false);
 		result.setMessage("Test threw default exception: ");
-		log(result);
 	}
+	return false;
+}
+#ifdef TEST_TESTHARNESS
+
+#include "LambdaTest.h"
+#include "DetailedLogging.h"
+
+/////////////////////////////////////////////////////////////////////
+// Demonstrates timeouts
+// - a test that polls its cancellation token stops when timed out
+// - a test that ignores it is abandoned and its worker replaced
+// - the run timeout reports tests that never started
+// Demonstrates worker processes
+// - a test that crashes its process is reported and the run goes on
+
+int main()
+{
+	cout << "\n  Demonstrating TestHarness timeouts";
+	cout << "\n ====================================\n\n";
+
+	CancellationToken token;
+	LambdaTest* polite = new LambdaTest([token]() {
+		while (!token.isCancelled())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return false;
+	}, "polls its cancellation token", "cancelled");
+	polite->setCancellationToken(token);
+
+	LambdaTest* stubborn = new LambdaTest([]() {
+		std::this_thread::sleep_for(std::chrono::seconds(2));
+		return true;
+	}, "ignores cancellation", "");
+	stubborn->setTimeout(std::chrono::milliseconds(50));
+
+	TestHarness harness(new DetailedLogging);
+	harness.setHistoryFile("");
+	harness.setWorkerCount(2);
+	harness.setTestTimeout(std::chrono::milliseconds(100));
+	harness.addTest(polite);
+	harness.addTest(stubborn);
+	for (int x = 0; x < 4; x++)
+		harness.addTest(new LambdaTest([]() { return true; }, "quick", ""));
+	for (int x = 0; x < 2; x++)
+		harness.addTest(new LambdaTest([]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(80));
+			return true;
+		}, "slow", ""));
+
+	auto start = steady_clock::now();
+	harness.run();
+	cout << "\n  run took " << std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock::now() - start).count() << " ms\n\n";
+
+	TestHarness limited(new DetailedLogging);
+	limited.setHistoryFile("");
+	limited.setWorkerCount(1);
+	limited.setRunTimeout(std::chrono::milliseconds(150));
+	for (int x = 0; x < 4; x++)
+		limited.addTest(new LambdaTest([]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			return true;
+		}, "100 ms", ""));
+	limited.run();
+
+	TestHarness isolated(new DetailedLogging);
+	isolated.setHistoryFile("");
+	isolated.addTest(new LambdaTest([]() { return true; }, "before crash", ""));
+	isolated.addTest(new LambdaTest([]() { std::abort(); return true; }, "calls abort", ""));
+	isolated.addTest(new LambdaTest([]() { return true; }, "after crash", ""));
+	isolated.run(ExecutionMode::PROCESSES);
+	cout << "\n\n";
+	std::_Exit(0);
+}
+
+#endif
+
+#ifdef BENCH_TESTHARNESS
+
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include "LambdaTest.h"
+
+/////////////////////////////////////////////////////////////////////
+// Scheduling overhead benchmark
+// - runs suites of trivial tests so the time measured is the cost of
+//   handing tests to workers, not of running them
+// - console output is switched off while the harness runs
+//
+// Worker processes are timed on the socket suite size, once as is and
+// once with a crashing test added for every ten
+//
+// Scaling benchmark, run with argument "scaling"
+// - wall time of a CPU-bound suite against worker count
+// - last row starts with one worker and adds the rest mid-run
+//
+// Distributed benchmark, run with argument "agents"
+// - throughput of a CPU-bound suite handed to 1, 2 and 4 forked agent
+//   processes with one slot each
+
+// counts results instead of displaying them
+class CountingLogging : public Logging
+{
+public:
+	CountingLogging() : Logging(LoggingLevel::BASIC) {}
+	~CountingLogging() override { Stop(); }
+	void DisplayResult(TestResult&) override { ++count; }
+	void FormatResult(const TestResult&, string&) override {}
+	std::atomic<size_t> count{ 0 };
+};
+
+vector<ITest*> trivialTests(size_t n)
+{
+	vector<ITest*> suite;
+	for (size_t x = 0; x < n; x++)
+		suite.push_back(new LambdaTest([]() { return true; }, "trivial", ""));
+	return suite;
+}
+
+// each test does about a millisecond of arithmetic
+vector<ITest*> cpuBoundTests(size_t n)
+{
+	vector<ITest*> suite;
+	for (size_t x = 0; x < n; x++)
+		suite.push_back(new LambdaTest([]() {
+			volatile double sum = 0;
+			for (int i = 1; i < 400000; i++)
+				sum = sum + 1.0 / i;
+			return sum > 0;
+		}, "cpu bound", ""));
+	return suite;
+}
+
+void scaling(size_t suiteSize)
+{
+	vector<ITest*> suite = cpuBoundTests(suiteSize);
+	size_t maxWorkers = 2 * std::max(1u, std::thread::hardware_concurrency());
+	auto coutBuf = cout.rdbuf(nullptr);
+	vector<std::pair<size_t, double>> rows;
+
+	for (size_t workers = 1; workers <= maxWorkers; workers *= 2)
+	{
+		TestHarness harness(new CountingLogging);
+		harness.setHistoryFile("");
+		for (auto test : suite)
+			harness.addTest(test);
+		harness.setWorkerCount(workers);
+		auto start = std::chrono::steady_clock::now();
+		harness.run();
+		rows.push_back({ workers, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() });
+	}
+
+	TestHarness harness(new CountingLogging);
+	harness.setHistoryFile("");
+	for (auto test : suite)
+		harness.addTest(test);
+	harness.setWorkerCount(1);
+	auto start = std::chrono::steady_clock::now();
+	thread grow([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		harness.setWorkerCount(maxWorkers);
+	});
+	harness.run();
+	grow.join();
+	double grown = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	cout.rdbuf(coutBuf);
+	cout << "\n  " << suiteSize << " CPU-bound tests, " << std::thread::hardware_concurrency() << " hardware threads";
+	cout << "\n  ----------------------------------------------";
+	cout << "\n  workers    wall ms    speedup";
+	for (auto& row : rows)
+		cout << "\n  " << row.first << std::string(row.first < 10 ? 10 : 9, ' ')
+			<< (size_t)(row.second * 1000) << std::string(11 - std::to_string((size_t)(row.second * 1000)).size(), ' ')
+			<< rows[0].second / row.second;
+	cout << "\n  1 -> " << maxWorkers << "     " << (size_t)(grown * 1000);
+	cout << "\n\n";
+}
+
+#ifndef _WIN32
+#include <sys/wait.h>
+
+void agents(size_t suiteSize)
+{
+	vector<ITest*> suite = cpuBoundTests(suiteSize);
+	auto coutBuf = cout.rdbuf(nullptr);
+	vector<std::pair<size_t, double>> rows;
+
+	for (size_t count = 1; count <= 4; count *= 2)
+	{
+		MsgPassingCommunication::EndPoint coordinator("localhost", 9300);
+		vector<pid_t> pids;
+		for (size_t x = 0; x < count; x++)
+		{
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				TestHarness agent(new CountingLogging);
+				for (auto test : suite)
+					agent.addTest(test);
+				agent.runAgent(coordinator, MsgPassingCommunication::EndPoint("localhost", 9301 + x), 1);
+				std::_Exit(0);
+			}
+			pids.push_back(pid);
+		}
+
+		TestHarness harness(new CountingLogging);
+		harness.setHistoryFile("");
+		for (auto test : suite)
+			harness.addTest(test);
+		harness.setCoordinator(coordinator);
+		auto start = std::chrono::steady_clock::now();
+		harness.run(ExecutionMode::DISTRIBUTED);
+		rows.push_back({ count, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() });
+		for (pid_t pid : pids)
+			waitpid(pid, nullptr, 0);
+	}
+
+	cout.rdbuf(coutBuf);
+	cout << "\n  " << suiteSize << " CPU-bound tests over agents, " << std::thread::hardware_concurrency() << " hardware threads";
+	cout << "\n  ----------------------------------------------";
+	cout << "\n  agents     wall ms    tests/sec";
+	for (auto& row : rows)
+		cout << "\n  " << row.first << "          "
+			<< (size_t)(row.second * 1000) << std::string(11 - std::to_string((size_t)(row.second * 1000)).size(), ' ')
+			<< (size_t)(suiteSize / row.second);
+	cout << "\n\n";
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+#ifndef _WIN32
+	if (argc > 1 && std::string(argv[1]) == "agents")
+	{
+		agents(argc > 2 ? std::stoul(argv[2]) : 256);
+		return 0;
+	}
+#endif
+	if (argc > 1 && std::string(argv[1]) == "scaling")
+	{
+		scaling(argc > 2 ? std::stoul(argv[2]) : 256);
+		return 0;
+	}
+
+	size_t InProcessTests = 100000;
+	size_t SocketTests = 2000;
+	if (argc > 1)
+		InProcessTests = std::stoul(argv[1]);
+	if (argc > 2)
+		SocketTests = std::stoul(argv[2]);
+
+	auto coutBuf = cout.rdbuf(nullptr);
+
+	TestHarness inProcessHarness(new CountingLogging);
+	inProcessHarness.setHistoryFile("");
+	for (auto test : trivialTests(InProcessTests))
+		inProcessHarness.addTest(test);
+	auto start = std::chrono::steady_clock::now();
+	inProcessHarness.run(ExecutionMode::IN_PROCESS);
+	double inProcess = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// worker processes, then again with every tenth test crashing its worker
+	double processes[2];
+	for (int crashing = 0; crashing < 2; crashing++)
+	{
+		TestHarness harness(new CountingLogging);
+		harness.setHistoryFile("");
+		for (auto test : trivialTests(SocketTests))
+			harness.addTest(test);
+		if (crashing)
+			for (size_t x = 0; x < SocketTests; x += 10)
+				harness.addTest(new LambdaTest([]() { std::abort(); return true; }, "crash", ""));
+		start = std::chrono::steady_clock::now();
+		harness.run(ExecutionMode::PROCESSES);
+		processes[crashing] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// the socket harness never returns, so watch its result count instead
+	CountingLogging* counter = new CountingLogging;
+	vector<ITest*> socketSuite = trivialTests(SocketTests);
+	start = std::chrono::steady_clock::now();
+	thread([=]() {
+		TestHarness harness(counter);
+		harness.setHistoryFile("");
+		for (auto test : socketSuite)
+			harness.addTest(test);
+		harness.run(ExecutionMode::SOCKETS);
+	}).detach();
+	while (counter->count < SocketTests)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	double sockets = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	cout.rdbuf(coutBuf);
+	cout << "\n  Scheduling trivial tests";
+	cout << "\n  ------------------------";
+	cout << "\n  in process: " << InProcessTests << " tests in " << inProcess * 1000 << " ms, "
+		<< inProcess * 1e6 / InProcessTests << " us per test";
+	cout << "\n  processes:  " << SocketTests << " tests in " << processes[0] * 1000 << " ms, "
+		<< processes[0] * 1e6 / SocketTests << " us per test";
+	cout << "\n  processes with " << SocketTests / 10 << " crashes: " << processes[1] * 1000 << " ms";
+	cout << "\n  sockets:    " << SocketTests << " tests in " << sockets * 1000 << " ms, "
+		<< sockets * 1e6 / SocketTests << " us per test";
+	cout << "\n\n" << std::flush;
+	std::_Exit(0);
+}
 
-	std::cout << std::endl;
-}
\ No newline at end of file
+#endif
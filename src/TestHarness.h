@@ -11,12 +11,41 @@
 #include "TestResult.h"
 #include "Logging.h"
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <set>
 #include "Sockets.h"
 #include "Message.h"
 #include "Comm.h"
+#include "TestScheduler.h"
+#include "TestHistory.h"
+#include "ResultCache.h"
+#include "TestLibrary.h"
 
 using std::vector;
 
+/**
+* How the harness hands tests to its workers
+**/
+enum class ExecutionMode
+{
+	// worker threads take test ids from in-memory work-stealing deques
+	IN_PROCESS,
+	// scheduling decisions travel as Messages over Comm, so workers
+	// may live in other processes or on other machines
+	SOCKETS,
+	// each test runs in a pre-forked worker process that reports back
+	// over Comm, so a test that crashes takes down only its worker.
+	// POSIX only; elsewhere tests run in process
+	PROCESSES,
+	// this harness coordinates; agent processes, possibly on other
+	// machines, register with it and pull tests to run
+	DISTRIBUTED
+};
+
 /**
 * Test harness used to run all tests and display results
 **/
@@ -35,8 +64,10 @@ public:
 	*
 	* @log[in] - pointer to logging abstraction to be used for logging
 	* @tests[in] - vectors of tests to be run in parralel
+	* @mode[in] - whether tests are dispatched in memory or over sockets
+	* @workers[in] - number of worker threads; 0 uses one per hardware thread
 	**/
-	TestHarness(Logging* log, vector<ITest*> tests);
+	TestHarness(Logging* log, vector<ITest*> tests, ExecutionMode mode = ExecutionMode::IN_PROCESS, size_t workers = 0);
 
 	/**
 	* Destructor
@@ -55,7 +86,140 @@ public:
 	**/
 	void addTest(ITest* test);
 
+	/**
+	* Adds the tests a shared library registers. The library stays loaded
+	* for the life of the process, so adding it again, e.g. for another
+	* run, costs only a lookup. Throws std::runtime_error if it can't be
+	* loaded.
+	*
+	* @path[in] - file name of the library; see TestLibrary.h
+	**/
+	void addLibrary(const string& path);
+
+	/**
+	* Runs all of the tests added to the test harness on worker threads.
+	* In process, returns once every test has run.
+	*
+	* @mode[in] - whether tests are dispatched in memory or over sockets
+	**/
+	void run(ExecutionMode mode = ExecutionMode::IN_PROCESS);
+
+	/**
+	* Sets the number of workers. May be called from another thread while
+	* a run is in progress: extra workers join immediately, surplus workers
+	* leave once they finish their current test.
+	*
+	* @count[in] - number of workers; 0 uses one per hardware thread
+	**/
+	void setWorkerCount(size_t count);
+
+	/**
+	* Returns the number of workers the harness is aiming for
+	**/
+	size_t getWorkerCount() const;
+
+	/**
+	* Sets the file that keeps test durations between runs. Durations are
+	* read when a run starts and written when it finishes. An empty path,
+	* the default, turns history off.
+	*
+	* @path[in] - history file
+	**/
+	void setHistoryFile(const string& path);
+
+	/**
+	* Sets the file that keeps passing results between runs. A test whose
+	* executable or library, name and declared inputs are unchanged since
+	* it last passed is reported from the cache instead of being run. An
+	* empty path, the default, turns the cache off. Distributed runs don't
+	* use it, since agents number tests by their own full suite. Results
+	* are matched to tests by name, so tests whose names aren't unique
+	* are always run, with a warning.
+	*
+	* @path[in] - result cache file
+	**/
+	void setResultCacheFile(const string& path);
+
+	/**
+	* Runs every test even if it has a cached result. Results still
+	* refresh the cache.
+	*
+	* @force[in] - true to ignore cached results
+	**/
+	void setForceRun(bool force);
+
+	/**
+	* Sets the time limit for each test that doesn't set its own. A test
+	* over its limit is reported as timed out and its cancellation token is
+	* set. If it hasn't returned shortly after, its worker is abandoned
+	* and replaced.
+	*
+	* @limit[in] - time limit per test; zero means no limit
+	**/
+	void setTestTimeout(std::chrono::milliseconds limit);
+
+	/**
+	* Sets the time limit for a whole in-process or SOCKETS run. When it expires,
+	* tests not yet started are reported as not run and running tests are
+	* timed out.
+	*
+	* @limit[in] - time limit per run; zero means no limit
+	**/
+	void setRunTimeout(std::chrono::milliseconds limit);
+
+	/**
+	* Sets the ports handed to SOCKETS and PROCESSES workers and to the
+	* PROCESSES coordinator, 9194 to 10193 by default. A port is reused
+	* once its worker exits, and one that can't be bound is skipped. A
+	* range outside 1 to 65535, or empty, is ignored.
+	*
+	* @first[in] - lowest port
+	* @last[in] - highest port
+	**/
+	void setPortRange(int first, int last);
+
+	/**
+	* Sets the end point a DISTRIBUTED run listens on. Agents must be
+	* given the same end point.
+	*
+	* @ep[in] - coordinator end point, localhost:9191 by default
+	**/
+	void setCoordinator(const MsgPassingCommunication::EndPoint& ep);
+
+	/**
+	* Runs this process as an agent of a DISTRIBUTED run: registers with
+	* the coordinator, runs the tests it is sent on its slots and returns
+	* when the coordinator says the run is over. The agent must hold the
+	* same tests, in the same order, as the coordinator.
+	*
+	* @coordinator[in] - end point the coordinator listens on
+	* @self[in] - this agent's end point, reachable from the coordinator
+	* @slots[in] - number of tests to run at once; 0 uses the worker count
+	**/
+	void runAgent(const MsgPassingCommunication::EndPoint& coordinator,
+		const MsgPassingCommunication::EndPoint& self, size_t slots = 0);
+
 private:
+	/**
+	* What a worker is doing, shared by the worker and the watchdog. An
+	* abandoned worker keeps its own reference, so it can find out it was
+	* abandoned without touching the harness.
+	**/
+	struct WorkerState
+	{
+		// status is IDLE, ABANDONED, 2 * id while test id runs, or
+		//	2 * id + 1 once the watchdog has reported test id as timed out;
+		//	one atomic so worker and watchdog can't both act on a test
+		enum Status : long long { IDLE = -1, ABANDONED = -2 };
+		std::atomic<long long> status{ IDLE };
+		std::atomic<std::chrono::steady_clock::rep> started{ 0 };
+		std::chrono::steady_clock::time_point cancelled;
+		// the rest of a socket worker's chunk, from chunk[next]
+		vector<int> chunk;
+		size_t next = 0;
+		bool done = false;
+		std::thread thread;
+	};
 	/**
 	* Logs a new test result message
 	*
@@ -63,19 +227,168 @@ private:
 	**/
 	void log(TestResult result);
 
+	/**
+	* Runs all tests on a pool of worker threads that share the work by
+	* stealing. Returns when every test has run.
+	**/
+	void runInProcess();
+
+	/**
+	* Runs all tests in a pool of worker processes. Keeps a few warm
+	* spares so a crashed worker is replaced at once. Returns when every
+	* test has run or crashed.
+	**/
+	void runInProcesses();
+
+	/**
+	* Runs all tests on agents that register over Comm. Agents may join
+	* during the run; the tests of an agent that goes silent are given to
+	* the others. Returns when every test has a result.
+	**/
+	void runDistributed();
+
+	/**
+	* Body of a worker process: runs the tests it is sent and reports each
+	* result as a Message. Never returns; the harness stops it.
+	*
+	* @port[in] - port number for the worker's communication end point
+	* @coordinatorPort[in] - port the harness listens on
+	**/
+	void childProcess(int port, int coordinatorPort);
+
+	/**
+	* Runs all tests on child threads that receive work as Messages.
+	* Each "runtest" message carries a chunk of test ids. Returns when
+	* every test has a result, then stops the children with "stop".
+	**/
+	void runOverSockets();
+
+	/**
+	* Starts workers until the target count is reached.
+	* Caller must hold workersMtx.
+	**/
+	void startWorkers();
+
+	/**
+	* Reports overdue tests, cancels them, and abandons and replaces
+	* workers that ignore cancellation. Caller must hold workersMtx.
+	*
+	* @runExpired[in] - true if the whole run is out of time
+	**/
+	void checkTimeouts(bool runExpired);
+
+	/**
+	* Logs a failed result for a test the harness gave up on
+	*
+	* @testId[in] - the test
+	* @message[in] - why it failed
+	**/
+	void reportFailure(int testId, const string& message);
+
+	/**
+	* Called by a worker before it runs a test
+	*
+	* @state[in] - the worker's state
+	* @testId[in] - the test about to run
+	**/
+	void beginTest(WorkerState& state, int testId);
+
+	/**
+	* Called by a worker after its test returns. Returns false if the
+	* worker was abandoned and must exit without touching the harness.
+	* Otherwise reports the result unless the watchdog already did.
+	*
+	* @state[in] - the worker's state
+	* @testId[in] - the test that was run
+	* @result[in] - its result
+	* @completed[in] - false if the test threw
+	**/
+	bool finishTest(WorkerState& state, int testId, TestResult& result, bool completed);
+
+	/**
+	* Marks a worker as finished and wakes the thread waiting for workers
+	*
+	* @state[in] - the worker's state
+	**/
+	void workerDone(WorkerState& state);
+
+	/**
+	* Called by a worker between tests. Returns true if the worker should
+	* leave because there are more workers than wanted.
+	**/
+	bool retireWorker();
+
+	/**
+	* Creates a new in-process worker thread
+	*
+	* @slot[in] - the worker's slot in the scheduler
+	* @state[in] - state shared with the watchdog
+	**/
+	void workerThread(size_t slot, std::shared_ptr<WorkerState> state);
+
 	/**
 	* Creates a new child thread
 	*
 	* @port[in] - port number for the child thread communication end point
+	* @state[in] - state shared with the watchdog
+	**/
+	void childThread(int port, std::shared_ptr<WorkerState> state);
+
+	/**
+	* Takes a free port from the port range, or returns -1 if every port
+	* in it is taken. The search goes round the range, so a port just
+	* given back isn't handed out again straight away.
+	**/
+	int acquirePort();
+
+	/**
+	* Gives a port taken by acquirePort back to the range
+	*
+	* @port[in] - the port
+	**/
+	void releasePort(int port);
+
+	/**
+	* Runs a single test. Returns its execution time in seconds, or a
+	* negative value if it threw.
+	*
+	* @test[in] - test to be run
 	**/
-	void childThread(int port);
+	double runTest(ITest* test);
 
 	/**
-	* Runs a single test
+	* Runs a single test without reporting it. Returns false if it threw.
 	*
 	* @test[in] - test to be run
+	* @result[out] - result of the test
 	**/
-	void runTest(ITest* test);
+	static bool executeTest(ITest* test, TestResult& result);
+
+	/**
+	* Returns the expected duration of each test. Tests without history
+	* are assumed to take as long as the average test that has history.
+	* Returns an empty vector if no test has history.
+	**/
+	vector<double> predictDurations();
+
+	/**
+	* Returns test ids ordered longest first, or in suite order if there
+	* are no predictions
+	*
+	* @predicted[in] - result of predictDurations
+	**/
+	vector<int> longestFirstOrder(const vector<double>& predicted);
+
+	/**
+	* Adds this run's measured durations to the history and saves it
+	**/
+	void saveHistory();
+
+	/**
+	* Reports the tests that have cached passing results and returns the
+	* rest. Notes each test's cache key for storing this run's results.
+	**/
+	vector<ITest*> skipCached();
 
 	// Collection of tests that are part of this test harness
 	vector<ITest*> tests;
@@ -87,7 +400,48 @@ private:
 	// the queue of tests that need to be run
 	BlockingQueue<int> testIds;
 
-	// temporary - used to store times for sleeping to demonstrate
-	//	tests beuing run in parallel
-	BlockingQueue<int> sleepTimes;
+	// how tests are handed to workers in the current run
+	ExecutionMode mode = ExecutionMode::IN_PROCESS;
+	// the number of workers wanted, and the number currently running
+	std::atomic<size_t> workerCount;
+	std::atomic<size_t> liveWorkers{ 0 };
+	// workers not yet joined; abandoned workers are detached and dropped
+	vector<std::shared_ptr<WorkerState>> workers;
+	std::mutex workersMtx;
+	std::condition_variable workersCv;
+	bool running = false;
+
+	// time limits; zero means none
+	std::chrono::milliseconds testTimeout{ 0 };
+	std::chrono::milliseconds runTimeout{ 0 };
+	// hands test ids to in-process workers
+	WorkStealingScheduler* scheduler = nullptr;
+	// ports handed to workers: the range, where the next search starts,
+	//	and the ports taken
+	int firstPort = 9194;
+	int lastPort = 10193;
+	int portCursor = 9194;
+	std::set<int> portsInUse;
+	std::mutex portsMtx;
+	// SOCKETS run: set once a test is started or given up on, so each
+	//	is reported once; and the number of tests reported so far
+	std::unique_ptr<std::atomic<bool>[]> claimed;
+	std::atomic<size_t> reportedCount{ 0 };
+	// where a distributed run listens
+	MsgPassingCommunication::EndPoint coordinatorEP{ "localhost", 9191 };
+
+	// durations from earlier runs, and where they are kept
+	TestHistory history;
+	string historyFile;
+	// seconds taken by each test in the current run, negative if not run
+	vector<double> measured;
+
+	// passing results from earlier runs, and where they are kept
+	ResultCache resultCache;
+	string resultCacheFile;
+	bool forceRun = false;
+	// cache key of each test in the current run, by name
+	std::unordered_map<string, unsigned long long> cacheKeys;
+	// library each test was loaded from; tests in the executable are absent
+	std::unordered_map<ITest*, string> testModules;
 };
\ No newline at end of file
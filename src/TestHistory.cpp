@@ -0,0 +1,146 @@
+/*
+	TestHistory.cpp
+
+	This file contains the implementation of the TestHistory class.
+	Remembers how long each test took in earlier runs.
+
+	File layout, integers big-endian:
+		"THST"                      magic
+		uint32                      number of entries
+		per entry:
+			uint16                  length of test name
+			name bytes
+			uint32                  estimated duration in microseconds
+*/
+
+#include "TestHistory.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	const char Magic[4] = { 'T', 'H', 'S', 'T' };
+
+	// weight given to the newest measurement
+	const double Smoothing = 0.5;
+
+	void putInt(std::string& dst, unsigned long value, int bytes)
+	{
+		for (int shift = 8 * (bytes - 1); shift >= 0; shift -= 8)
+			dst += static_cast<char>((value >> shift) & 0xff);
+	}
+
+	unsigned long getInt(const unsigned char* p, int bytes)
+	{
+		unsigned long value = 0;
+		for (int x = 0; x < bytes; x++)
+			value = (value << 8) | p[x];
+		return value;
+	}
+}
+
+bool TestHistory::load(const string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+	const unsigned char* end = p + data.size();
+
+	if (data.size() < 8 || !std::equal(Magic, Magic + 4, data.begin()))
+		return false;
+	unsigned long count = getInt(p + 4, 4);
+	p += 8;
+
+	std::unordered_map<string, double> loaded;
+	for (unsigned long x = 0; x < count; x++)
+	{
+		if (end - p < 2)
+			return false;
+		size_t nameLen = getInt(p, 2);
+		if ((size_t)(end - p) < 2 + nameLen + 4)
+			return false;
+		string name(reinterpret_cast<const char*>(p + 2), nameLen);
+		loaded[name] = getInt(p + 2 + nameLen, 4) / 1e6;
+		p += 2 + nameLen + 4;
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+	durations.swap(loaded);
+	return true;
+}
+
+bool TestHistory::save(const string& path) const
+{
+	std::string data(Magic, 4);
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		putInt(data, (unsigned long)durations.size(), 4);
+		for (auto& entry : durations)
+		{
+			// names longer than a uint16 length are cut; they still key consistently
+			size_t nameLen = entry.first.size() < 0xffff ? entry.first.size() : 0xffff;
+			double micros = entry.second * 1e6;
+			putInt(data, (unsigned long)nameLen, 2);
+			data.append(entry.first, 0, nameLen);
+			putInt(data, micros < 4294967295.0 ? (unsigned long)micros : 0xffffffffUL, 4);
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+	return (bool)out;
+}
+
+void TestHistory::record(const string& testName, double seconds)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = durations.find(testName);
+	if (iter == durations.end())
+		durations.emplace(testName, seconds);
+	else
+		iter->second = Smoothing * seconds + (1 - Smoothing) * iter->second;
+}
+
+double TestHistory::estimate(const string& testName) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = durations.find(testName);
+	return iter == durations.end() ? -1 : iter->second;
+}
+
+size_t TestHistory::size() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return durations.size();
+}
+
+#ifdef TEST_TESTHISTORY
+
+#include <iostream>
+#include <cstdio>
+
+int main()
+{
+	std::cout << "\n  Demonstrating TestHistory";
+	std::cout << "\n ===========================";
+
+	TestHistory history;
+	history.record("fast", 0.001);
+	history.record("slow", 2.0);
+	history.record("slow", 1.0);
+	history.save("TestHistory.test");
+
+	TestHistory reloaded;
+	reloaded.load("TestHistory.test");
+	std::cout << "\n  fast: " << reloaded.estimate("fast") << " sec";
+	std::cout << "\n  slow: " << reloaded.estimate("slow") << " sec";
+	std::cout << "\n  unknown: " << reloaded.estimate("unknown");
+	std::cout << "\n\n";
+	std::remove("TestHistory.test");
+}
+
+#endif
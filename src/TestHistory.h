@@ -0,0 +1,65 @@
+/*
+	TestHistory.h
+
+	This file contains the declaration of the TestHistory class.
+	Remembers how long each test took in earlier runs so the harness can
+	start the longest tests first. Durations are kept per test name in a
+	small binary file.
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+using std::string;
+
+/**
+* Per-test execution times carried from run to run
+**/
+class TestHistory
+{
+public:
+	/**
+	* Reads durations from a history file. A missing or unreadable file
+	* leaves the history empty. Returns true if the file was read.
+	*
+	* @path[in] - history file to read
+	**/
+	bool load(const string& path);
+
+	/**
+	* Writes all durations to a history file. Returns false on failure.
+	*
+	* @path[in] - history file to write
+	**/
+	bool save(const string& path) const;
+
+	/**
+	* Folds a new measurement into the estimate for a test. Estimates are
+	* smoothed so a single slow run doesn't reorder the suite.
+	*
+	* @testName[in] - name of the test
+	* @seconds[in] - measured execution time
+	**/
+	void record(const string& testName, double seconds);
+
+	/**
+	* Returns the estimated execution time of a test in seconds, or a
+	* negative value if the test has never been timed
+	*
+	* @testName[in] - name of the test
+	**/
+	double estimate(const string& testName) const;
+
+	/**
+	* Returns the number of tests with an estimate
+	**/
+	size_t size() const;
+
+private:
+	// estimated seconds per test name
+	std::unordered_map<string, double> durations;
+	mutable std::mutex mtx;
+};
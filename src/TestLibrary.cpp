@@ -0,0 +1,203 @@
+/*
+	TestLibrary.cpp
+
+	This file contains the implementation of the TestLibraries class.
+	Loads tests from shared libraries and keeps them loaded.
+*/
+
+#include "TestLibrary.h"
+#include <chrono>
+#include <stdexcept>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace
+{
+	double secondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void* openLibrary(const string& path, string& error)
+	{
+#ifdef _WIN32
+		HMODULE handle = path.empty() ? GetModuleHandleA(nullptr) : LoadLibraryA(path.c_str());
+		if (!handle)
+			error = "error " + std::to_string(GetLastError());
+		return handle;
+#else
+		// bind every symbol now so running the tests never stops to resolve one
+		void* handle = dlopen(path.empty() ? nullptr : path.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if (!handle)
+			error = dlerror();
+		return handle;
+#endif
+	}
+
+	void* findSymbol(void* handle, const char* name)
+	{
+#ifdef _WIN32
+		return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#else
+		return dlsym(handle, name);
+#endif
+	}
+
+	void closeLibrary(void* handle)
+	{
+#ifdef _WIN32
+		// the executable's own handle is not reference counted
+		if (handle != GetModuleHandleA(nullptr))
+			FreeLibrary(static_cast<HMODULE>(handle));
+#else
+		dlclose(handle);
+#endif
+	}
+}
+
+TestLibraries::~TestLibraries()
+{
+	for (auto& library : libraries)
+		close(library.second);
+}
+
+TestLibraries& TestLibraries::instance()
+{
+	static TestLibraries libraries;
+	return libraries;
+}
+
+const vector<ITest*>& TestLibraries::load(const string& path)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto cached = libraries.find(path);
+	if (cached != libraries.end())
+	{
+		cached->second.metrics.cacheHits++;
+		return cached->second.tests;
+	}
+
+	Library library;
+	string error;
+	auto start = std::chrono::steady_clock::now();
+	library.handle = openLibrary(path, error);
+	library.metrics.openSeconds = secondsSince(start);
+	if (!library.handle)
+		throw std::runtime_error("can't open test library " + path + ": " + error);
+
+	start = std::chrono::steady_clock::now();
+	library.entry = reinterpret_cast<RegisterTestsFunction>(findSymbol(library.handle, TEST_LIBRARY_ENTRY));
+	library.metrics.resolveSeconds = secondsSince(start);
+	if (!library.entry)
+	{
+		close(library);
+		throw std::runtime_error("test library " + path + " has no " TEST_LIBRARY_ENTRY " function");
+	}
+
+	start = std::chrono::steady_clock::now();
+	try
+	{
+		library.entry(library.tests);
+	}
+	catch (...)
+	{
+		// the tests it did register live in the library, so they go with it
+		close(library);
+		throw;
+	}
+	library.metrics.registerSeconds = secondsSince(start);
+	library.metrics.testCount = library.tests.size();
+
+	return libraries.emplace(path, std::move(library)).first->second.tests;
+}
+
+bool TestLibraries::unload(const string& path)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto library = libraries.find(path);
+	if (library == libraries.end())
+		return false;
+	close(library->second);
+	libraries.erase(library);
+	return true;
+}
+
+TestLibraryMetrics TestLibraries::metrics(const string& path) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto library = libraries.find(path);
+	return library == libraries.end() ? TestLibraryMetrics() : library->second.metrics;
+}
+
+void TestLibraries::report(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	for (auto& library : libraries)
+	{
+		const TestLibraryMetrics& metrics = library.second.metrics;
+		out << (library.first.empty() ? "(executable)" : library.first) << ": "
+			<< metrics.testCount << " test(s), open " << std::fixed << std::setprecision(3)
+			<< metrics.openSeconds * 1000 << " ms, resolve " << metrics.resolveSeconds * 1000
+			<< " ms, register " << metrics.registerSeconds * 1000 << " ms, "
+			<< metrics.cacheHits << " cache hit(s)" << std::defaultfloat << std::endl;
+	}
+}
+
+void TestLibraries::close(Library& library)
+{
+	if (library.handle)
+		closeLibrary(library.handle);
+	library.handle = nullptr;
+	library.entry = nullptr;
+	library.tests.clear();
+}
+
+#ifdef TEST_TESTLIBRARY
+
+// build with -rdynamic (or an export table on Windows) so the executable
+//	can load itself as a test library
+#include "LambdaTest.h"
+#include <iostream>
+
+extern "C"
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+void registerTests(vector<ITest*>& tests)
+{
+	static LambdaTest passes([]() { return true; }, "library test passes", "");
+	static LambdaTest fails([]() { return false; }, "library test fails", "expected failure");
+	tests.push_back(&passes);
+	tests.push_back(&fails);
+}
+
+int main()
+{
+	std::cout << "\n  Demonstrating TestLibraries";
+	std::cout << "\n =============================\n";
+
+	TestLibraries& libraries = TestLibraries::instance();
+	for (int run = 0; run < 3; run++)
+	{
+		for (ITest* test : libraries.load(""))
+			std::cout << "  run " << run << ": " << test->getTestName() << " -> "
+				<< (test->run() ? "pass" : "fail") << "\n";
+	}
+	try
+	{
+		libraries.load("no-such-library");
+	}
+	catch (std::exception& ex)
+	{
+		std::cout << "  " << ex.what() << "\n";
+	}
+	libraries.report(std::cout);
+	std::cout << "\n";
+}
+
+#endif
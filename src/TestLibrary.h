@@ -0,0 +1,111 @@
+/*
+	TestLibrary.h
+
+	This file contains the declaration of the TestLibraries class.
+	Loads tests from shared libraries. A library exports
+
+		extern "C" void registerTests(std::vector<ITest*>& tests);
+
+	which appends its tests; they must stay valid while the library is
+	loaded, so a library usually keeps them as statics. Libraries are
+	opened once, with all symbols bound up front, and kept open, so later
+	runs in the same process reuse the handle and the registered tests.
+*/
+
+#pragma once
+
+#include "ITest.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <ostream>
+
+using std::string;
+using std::vector;
+
+// name of the function a test library exports
+#define TEST_LIBRARY_ENTRY "registerTests"
+
+// signature of the function a test library exports
+typedef void (*RegisterTestsFunction)(vector<ITest*>& tests);
+
+/**
+* Time spent making a library's tests available
+**/
+struct TestLibraryMetrics
+{
+	// opening the library, including relocation
+	double openSeconds = 0;
+	// looking up the entry point
+	double resolveSeconds = 0;
+	// running the entry point
+	double registerSeconds = 0;
+	size_t testCount = 0;
+	// requests answered from the cache
+	size_t cacheHits = 0;
+};
+
+/**
+* Cache of opened test libraries, keyed by path
+**/
+class TestLibraries
+{
+public:
+	/**
+	* Closes every library; tests obtained from them become invalid
+	**/
+	~TestLibraries();
+
+	/**
+	* Returns the cache shared by the whole process
+	**/
+	static TestLibraries& instance();
+
+	/**
+	* Returns the tests a library registers, opening it the first time.
+	* An empty path means the running executable, which must export the
+	* entry point. Throws std::runtime_error if the library can't be
+	* opened or has no entry point. If the entry point throws, the library
+	* is closed and the exception passed on.
+	*
+	* @path[in] - file name of the library
+	**/
+	const vector<ITest*>& load(const string& path);
+
+	/**
+	* Closes a library; tests obtained from it become invalid. Returns
+	* false if it wasn't loaded.
+	*
+	* @path[in] - path given to load
+	**/
+	bool unload(const string& path);
+
+	/**
+	* Returns the load metrics of a library, all zero if it isn't loaded
+	*
+	* @path[in] - path given to load
+	**/
+	TestLibraryMetrics metrics(const string& path) const;
+
+	/**
+	* Writes a line of load metrics per library
+	*
+	* @out[in] - stream to write to
+	**/
+	void report(std::ostream& out) const;
+
+private:
+	struct Library
+	{
+		void* handle = nullptr;
+		RegisterTestsFunction entry = nullptr;
+		vector<ITest*> tests;
+		TestLibraryMetrics metrics;
+	};
+
+	static void close(Library& library);
+
+	std::map<string, Library> libraries;
+	mutable std::mutex mtx;
+};
@@ -9,39 +9,126 @@
 #include "TestResult.h"
 #include <string>
 #include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
 
 using std::string;
 using std::to_string;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+using std::chrono::nanoseconds;
 
-#define MONTH_OFFSET 1
-#define YEAR_OFFSET 1900
+namespace
+{
+    /**
+    * A steady_clock time and the system clock time it corresponds to
+    **/
+    struct ClockAnchor
+    {
+        steady_clock::time_point steady;
+        system_clock::time_point wall;
+    };
+
+    std::mutex anchorMtx;
+    ClockAnchor anchor;
+    bool anchored = false;
+
+    ClockAnchor currentAnchor()
+    {
+        std::lock_guard<std::mutex> lock(anchorMtx);
+        if (!anchored)
+        {
+            anchor.steady = steady_clock::now();
+            anchor.wall = system_clock::now();
+            anchored = true;
+        }
+        return anchor;
+    }
+
+    long long nowTicks()
+    {
+        return steady_clock::now().time_since_epoch().count();
+    }
+
+    // Wall-clock time of a steady_clock time, in nanoseconds since the epoch
+    long long wallNanoseconds(long long ticks)
+    {
+        ClockAnchor clocks = currentAnchor();
+        nanoseconds sinceAnchor = std::chrono::duration_cast<nanoseconds>(steady_clock::duration(ticks) - clocks.steady.time_since_epoch());
+        return (std::chrono::duration_cast<nanoseconds>(clocks.wall.time_since_epoch()) + sinceAnchor).count();
+    }
+
+    // steady_clock time of a wall-clock time, in ticks
+    long long steadyTicks(long long wallNanoseconds)
+    {
+        ClockAnchor clocks = currentAnchor();
+        nanoseconds sinceAnchor = nanoseconds(wallNanoseconds) - std::chrono::duration_cast<nanoseconds>(clocks.wall.time_since_epoch());
+        return (clocks.steady.time_since_epoch() + std::chrono::duration_cast<steady_clock::duration>(sinceAnchor)).count();
+    }
+
+    // ctime format, including its newline; empty for ticks not recorded
+    string formatDateTime(long long ticks)
+    {
+        if (ticks == 0)
+            return "";
+        system_clock::time_point when(std::chrono::duration_cast<system_clock::duration>(nanoseconds(wallNanoseconds(ticks))));
+        time_t when_t = system_clock::to_time_t(when);
+        char dateTime[32];
+#ifdef _WIN32
+        if (ctime_s(dateTime, sizeof(dateTime), &when_t) != 0)
+            return "";
+#else
+        if (ctime_r(&when_t, dateTime) == nullptr)
+            return "";
+#endif
+        return dateTime;
+    }
+
+    // ISO 8601 UTC with milliseconds; empty for ticks not recorded
+    string formatTimestamp(long long ticks)
+    {
+        if (ticks == 0)
+            return "";
+        long long ns = wallNanoseconds(ticks);
+        time_t when_t = static_cast<time_t>(ns / 1000000000);
+        int millis = static_cast<int>(ns % 1000000000 / 1000000);
+        std::tm when;
+#ifdef _WIN32
+        if (gmtime_s(&when, &when_t) != 0)
+            return "";
+#else
+        if (gmtime_r(&when_t, &when) == nullptr)
+            return "";
+#endif
+        char timestamp[40];
+        size_t length = strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &when);
+        snprintf(timestamp + length, sizeof(timestamp) - length, ".%03dZ", millis);
+        return timestamp;
+    }
+}
 
 TestResult::TestResult() :
-    testName(""), message(""), successful(false), startTime(std::chrono::system_clock::now()), endTime(std::chrono::system_clock::now()), executionTime(0), functionStartDateTime(""), functionEndDateTime("") {}
+    outcome{ false, false, 0, 0 }, message(""), testName("") {}
 
 void TestResult::recordStartTime()
 {
-    // Grab system clock time.
-    startTime = std::chrono::system_clock::now();
-    // Convert to time_t type so we can use ctime library facilities.
-    time_t startTime_t = std::chrono::system_clock::to_time_t(endTime);
-
-    // Convert to date/time string.
-    functionStartDateTime = std::ctime(&startTime_t);
+    // Grab steady clock time; the date is worked out if it's asked for.
+    outcome.startTicks = nowTicks();
 }
 
 void TestResult::recordEndTime()
 {
-    // Grab system clock time.
-    endTime = std::chrono::system_clock::now();
-    // Convert to time_t type so we can use ctime library facilities.
-    time_t endTime_t = std::chrono::system_clock::to_time_t(endTime);
-
-    // Convert to date/time string.
-    functionEndDateTime = std::ctime(&endTime_t);
+    // Grab steady clock time; the date is worked out if it's asked for.
+    outcome.endTicks = nowTicks();
+}
 
-    // Calculate execution duration.
-    calculateExecutionTime();
+void TestResult::anchorClock()
+{
+    std::lock_guard<std::mutex> lock(anchorMtx);
+    anchor.steady = steady_clock::now();
+    anchor.wall = system_clock::now();
+    anchored = true;
 }
 
 void TestResult::setMessage(const string msg)
@@ -71,35 +158,132 @@ string TestResult::getTestName() const
 void TestResult::setIsSuccessful(const bool isSucc)
 {
     // Function Pass/Fail mutator
-    successful = isSucc;
+    outcome.successful = isSucc;
 }
 
 bool TestResult::getIsSuccessful() const
 {
     // Function Pass/Fail accessor
-    return successful;
+    return outcome.successful;
+}
+
+void TestResult::setIsCached(const bool isCached)
+{
+    // cache hit mutator
+    outcome.cached = isCached;
+}
+
+bool TestResult::getIsCached() const
+{
+    // cache hit accessor
+    return outcome.cached;
 }
 
 string TestResult::getFunctionStartDateTime() const
 {
     // Function Start Date and Time accessor
-    return functionStartDateTime;
+    return formatDateTime(outcome.startTicks);
 }
 
 string TestResult::getFunctionEndDateTime() const
 {
     // Function End Date and Time accessor
-    return functionEndDateTime;
+    return formatDateTime(outcome.endTicks);
 }
 
-inline void TestResult::calculateExecutionTime()
+string TestResult::getFunctionStartTimestamp() const
 {
-    //Calculate function execution time
-    executionTime = endTime - startTime;
+    // Function Start timestamp accessor
+    return formatTimestamp(outcome.startTicks);
+}
+
+string TestResult::getFunctionEndTimestamp() const
+{
+    // Function End timestamp accessor
+    return formatTimestamp(outcome.endTicks);
+}
+
+long long TestResult::getFunctionStartNanoseconds() const
+{
+    // Function Start wall-clock time accessor
+    return outcome.startTicks == 0 ? 0 : wallNanoseconds(outcome.startTicks);
 }
 
 double TestResult::getFunctionExecutionTime() const
 {
     // Function execution time accessor
-    return executionTime.count();
+    if (outcome.startTicks == 0 || outcome.endTicks == 0)
+        return 0;
+    return std::chrono::duration<double>(steady_clock::duration(outcome.endTicks - outcome.startTicks)).count();
+}
+
+const TestOutcome& TestResult::getOutcome() const
+{
+    // Pass/Fail and timing accessor
+    return outcome;
+}
+
+void TestResult::setOutcome(const TestOutcome& testOutcome)
+{
+    // Pass/Fail and timing mutator
+    outcome = testOutcome;
+}
+
+// Each field is written as <length>:<bytes>, so fields may hold any
+// characters.
+namespace
+{
+    void putField(string& dst, const string& field)
+    {
+        dst += to_string(field.size());
+        dst += ':';
+        dst += field;
+    }
+
+    bool getField(const string& src, size_t& pos, string& field)
+    {
+        size_t colon = src.find(':', pos);
+        if (colon == string::npos || colon == pos)
+            return false;
+        size_t length = 0;
+        for (size_t x = pos; x < colon; x++)
+        {
+            if (src[x] < '0' || src[x] > '9')
+                return false;
+            length = length * 10 + (src[x] - '0');
+        }
+        if (length > src.size() - colon - 1)
+            return false;
+        field.assign(src, colon + 1, length);
+        pos = colon + 1 + length;
+        return true;
+    }
+}
+
+string TestResult::serialize() const
+{
+    // Times travel as wall-clock nanoseconds, since the receiver's
+    //  steady_clock may count from a different point.
+    string data;
+    putField(data, testName);
+    putField(data, outcome.successful ? "1" : "0");
+    putField(data, message);
+    putField(data, to_string(outcome.startTicks == 0 ? 0 : wallNanoseconds(outcome.startTicks)));
+    putField(data, to_string(outcome.endTicks == 0 ? 0 : wallNanoseconds(outcome.endTicks)));
+    return data;
+}
+
+bool TestResult::deserialize(const string& data)
+{
+    size_t pos = 0;
+    string isSuccessful, start, end;
+    if (!getField(data, pos, testName) || !getField(data, pos, isSuccessful) || !getField(data, pos, message)
+        || !getField(data, pos, start) || !getField(data, pos, end))
+        return false;
+    outcome.successful = (isSuccessful == "1");
+    long long startNanoseconds = strtoll(start.c_str(), nullptr, 10);
+    long long endNanoseconds = strtoll(end.c_str(), nullptr, 10);
+    outcome.startTicks = startNanoseconds == 0 ? 0 : steadyTicks(startNanoseconds);
+    outcome.endTicks = endNanoseconds == 0 ? 0 : steadyTicks(endNanoseconds);
+    return true;
 }
@@ -4,6 +4,11 @@
     This file contains the declaration of the TestHarness class.
     Provides a container to store test execution data. Also, provides
     an interface to communicate result data to the logging mechanism.
+
+    Start and end times are recorded as raw steady_clock ticks, so the
+    execution time can't be skewed by changes to the system clock. Dates
+    are worked out from one wall-clock anchor per run, and formatted only
+    when a logger asks for them.
 */
 
 #ifndef TestResult_h
@@ -13,12 +18,25 @@
 
 #include <string>
 #include <chrono>
+#include <type_traits>
 
 using std::string;
 
-// Typedefs for simplified chrono library use.
-typedef std::chrono::system_clock::time_point t_point;
-typedef std::chrono::duration<double> duration;
+/**
+* Fixed size part of a test result: PASS/FAIL and its timing. Trivially
+* copyable, so it can be queued or sent as raw bytes
+**/
+struct TestOutcome
+{
+    bool successful;
+    // reported from the result cache rather than run
+    bool cached;
+    // steady_clock ticks, zero if not recorded
+    long long startTicks;
+    long long endTicks;
+};
+
+static_assert(std::is_trivially_copyable<TestOutcome>::value, "TestOutcome is copied as raw bytes");
 
 /**
 * Stores the data for a test result
@@ -42,10 +60,11 @@ public:
     void recordEndTime();
 
     /**
-    * Calculates the execution time of the test
+    * Pairs the current steady_clock time with the system clock, for
+    * turning ticks into dates. Called once at the start of each run
     **/
-    inline void calculateExecutionTime();
-    
+    static void anchorClock();
+
     /**
     * Setter for the message
     **/
@@ -54,8 +73,8 @@ public:
     /**
     * Getter for the message
     **/
-    string getMessage() const;    
-    
+    string getMessage() const;
+
     /**
     * Setter for the test name
     **/
@@ -65,7 +84,7 @@ public:
     * Getter for the test name
     **/
     string getTestName() const;
-    
+
     /**
     * Setter for whether test is successul
     **/
@@ -77,29 +96,64 @@ public:
     bool getIsSuccessful() const;
 
     /**
-    *  Getter for start time
+    * Setter and getter for whether the result came from the result cache
+    **/
+    void setIsCached(const bool);
+    bool getIsCached() const;
+
+    /**
+    * Getter for start time, formatted on each call. Empty if the test
+    * never started
     **/
     string getFunctionStartDateTime() const;
 
     /**
-    * Getter for end time
+    * Getter for end time, formatted on each call. Empty if the test
+    * never finished
     **/
     string getFunctionEndDateTime() const;
 
+    /**
+    * Getters for start and end time as ISO 8601 UTC timestamps with
+    * milliseconds, e.g. 2026-10-17T09:30:00.125Z. Empty if not recorded
+    **/
+    string getFunctionStartTimestamp() const;
+    string getFunctionEndTimestamp() const;
+
+    /**
+    * Getter for start time as wall-clock nanoseconds since the epoch.
+    * Zero if not recorded
+    **/
+    long long getFunctionStartNanoseconds() const;
+
     /**
     * Getter for execution time
     **/
     double getFunctionExecutionTime() const;
-    
+
+    /**
+    * Getter and setter for PASS/FAIL and timing together
+    **/
+    const TestOutcome& getOutcome() const;
+    void setOutcome(const TestOutcome& testOutcome);
+
+    /**
+    * Encodes the result so it can be sent to another process
+    **/
+    string serialize() const;
+
+    /**
+    * Rebuilds a result encoded by serialize. Returns false, leaving the
+    * result partly filled, if the data is malformed.
+    *
+    * @data[in] - output of serialize
+    **/
+    bool deserialize(const string& data);
+
 private:
-    bool successful;
+    TestOutcome outcome;
     string message;
     string testName;
-    t_point startTime;
-    t_point endTime;
-    duration executionTime;
-    string functionStartDateTime;
-    string functionEndDateTime;
 };
 
 #endif /* TestResult_h */
@@ -0,0 +1,209 @@
+/*
+	TestScheduler.cpp
+
+	This file contains the implementation of the WorkStealingScheduler class.
+	Hands out the ids of a fixed set of tests to in-process workers.
+*/
+
+#include "TestScheduler.h"
+#include <thread>
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+WorkStealingScheduler::WorkStealingScheduler(size_t testCount, size_t workers) : remaining(testCount)
+{
+	if (workers == 0)
+		workers = 1;
+
+	// contiguous chunks whose sizes differ by at most one
+	size_t base = testCount / workers, extra = testCount % workers, id = 0;
+	for (size_t x = 0; x < workers; x++)
+	{
+		deques.emplace_back(new WorkDeque);
+		size_t len = base + (x < extra ? 1 : 0);
+		for (size_t y = 0; y < len; y++)
+			deques.back()->ids.push_back((int)id++);
+	}
+}
+
+WorkStealingScheduler::WorkStealingScheduler(const std::vector<std::vector<int>>& seeds) : remaining(0)
+{
+	for (auto& seed : seeds)
+	{
+		deques.emplace_back(new WorkDeque);
+		deques.back()->ids.assign(seed.begin(), seed.end());
+		remaining += seed.size();
+	}
+	if (deques.empty())
+		deques.emplace_back(new WorkDeque);
+}
+
+std::vector<std::vector<int>> WorkStealingScheduler::longestFirst(const std::vector<double>& durations, size_t workers, double& makespan)
+{
+	if (workers == 0)
+		workers = 1;
+
+	std::vector<int> order(durations.size());
+	for (size_t x = 0; x < order.size(); x++)
+		order[x] = (int)x;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return durations[a] > durations[b]; });
+
+	// min-heap of (load, worker)
+	typedef std::pair<double, size_t> Load;
+	std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+	for (size_t x = 0; x < workers; x++)
+		loads.push({ 0.0, x });
+
+	std::vector<std::vector<int>> seeds(workers);
+	for (int id : order)
+	{
+		Load least = loads.top();
+		loads.pop();
+		seeds[least.second].push_back(id);
+		loads.push({ least.first + durations[id], least.second });
+	}
+
+	makespan = 0;
+	while (!loads.empty())
+	{
+		makespan = std::max(makespan, loads.top().first);
+		loads.pop();
+	}
+	return seeds;
+}
+
+size_t WorkStealingScheduler::addWorker()
+{
+	std::unique_lock<std::shared_mutex> lock(dequesMtx);
+	if (slotsUsed == deques.size())
+		deques.emplace_back(new WorkDeque);
+	return slotsUsed++;
+}
+
+int WorkStealingScheduler::next(size_t slot)
+{
+	WorkDeque* own;
+	{
+		std::shared_lock<std::shared_mutex> lock(dequesMtx);
+		own = deques[slot].get();
+	}
+
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(own->mtx);
+			if (!own->ids.empty())
+			{
+				int id = own->ids.front();
+				own->ids.pop_front();
+				--remaining;
+				return id;
+			}
+		}
+
+		if (remaining == 0)
+			return -1;
+
+		// a failed steal with work remaining means ids are moving
+		//	between two other deques; look again shortly
+		if (!steal(slot))
+			std::this_thread::yield();
+	}
+}
+
+bool WorkStealingScheduler::steal(size_t thief)
+{
+	std::shared_lock<std::shared_mutex> lock(dequesMtx);
+	size_t count = deques.size();
+
+	for (size_t x = 1; x < count; x++)
+	{
+		WorkDeque& victim = *deques[(thief + x) % count];
+		std::deque<int> loot;
+		{
+			std::lock_guard<std::mutex> victimLock(victim.mtx);
+			size_t take = (victim.ids.size() + 1) / 2;
+			if (take == 0)
+				continue;
+			// the victim runs from the front, so take from the back
+			loot.assign(victim.ids.end() - take, victim.ids.end());
+			victim.ids.erase(victim.ids.end() - take, victim.ids.end());
+		}
+
+		WorkDeque& own = *deques[thief];
+		std::lock_guard<std::mutex> ownLock(own.mtx);
+		own.ids.insert(own.ids.end(), loot.begin(), loot.end());
+		++stealCount;
+		return true;
+	}
+	return false;
+}
+
+std::vector<int> WorkStealingScheduler::drain()
+{
+	std::vector<int> drained;
+	std::shared_lock<std::shared_mutex> lock(dequesMtx);
+	for (auto& deque : deques)
+	{
+		std::lock_guard<std::mutex> dequeLock(deque->mtx);
+		drained.insert(drained.end(), deque->ids.begin(), deque->ids.end());
+		remaining -= deque->ids.size();
+		deque->ids.clear();
+	}
+	return drained;
+}
+
+size_t WorkStealingScheduler::steals() const
+{
+	return stealCount;
+}
+
+#ifdef TEST_TESTSCHEDULER
+
+#include <iostream>
+#include <set>
+
+int main()
+{
+	std::cout << "\n  Demonstrating WorkStealingScheduler";
+	std::cout << "\n =====================================";
+
+	const size_t Tests = 10000;
+	WorkStealingScheduler scheduler(Tests, 2);
+	std::mutex mtx;
+	std::set<int> seen;
+	std::vector<std::thread> workers;
+
+	// two seeded workers and two latecomers that only steal
+	for (int x = 0; x < 4; x++)
+	{
+		size_t slot = scheduler.addWorker();
+		workers.emplace_back([&, slot]() {
+			int id;
+			while ((id = scheduler.next(slot)) >= 0)
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				seen.insert(id);
+			}
+		});
+	}
+	for (auto& w : workers)
+		w.join();
+
+	std::cout << "\n  " << seen.size() << " of " << Tests << " ids handed out once each";
+	std::cout << "\n  " << scheduler.steals() << " steals";
+
+	double makespan;
+	auto seeds = WorkStealingScheduler::longestFirst({ 5, 4, 3, 3, 2, 2, 1 }, 2, makespan);
+	for (size_t x = 0; x < seeds.size(); x++)
+	{
+		std::cout << "\n  worker " << x << " seeded with";
+		for (int id : seeds[x])
+			std::cout << " " << id;
+	}
+	std::cout << "\n  predicted makespan " << makespan;
+	std::cout << "\n\n";
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+	TestScheduler.h
+
+	This file contains the declaration of the WorkStealingScheduler class.
+	Hands out the ids of a fixed set of tests to in-process workers. Each
+	worker owns a deque of ids; a worker whose deque runs dry steals half
+	of another worker's remaining ids.
+*/
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+/**
+* Work-stealing distribution of test ids
+**/
+class WorkStealingScheduler
+{
+public:
+	/**
+	* Constructor splits the ids 0 .. testCount-1 into contiguous chunks,
+	* one per initial worker
+	*
+	* @testCount[in] - number of tests to schedule
+	* @workers[in] - number of deques to seed
+	**/
+	WorkStealingScheduler(size_t testCount, size_t workers);
+
+	/**
+	* Constructor seeds one deque per initial worker with the given ids.
+	* Each worker runs its ids from front to back.
+	*
+	* @seeds[in] - test ids for each initial worker
+	**/
+	WorkStealingScheduler(const std::vector<std::vector<int>>& seeds);
+
+	/**
+	* Longest processing time first: assigns tests in decreasing order of
+	* duration, each to the worker with the least work so far. Returns the
+	* per-worker seeds, longest first within each worker.
+	*
+	* @durations[in] - expected seconds for each test id
+	* @workers[in] - number of workers
+	* @makespan[out] - expected wall time of the busiest worker
+	**/
+	static std::vector<std::vector<int>> longestFirst(const std::vector<double>& durations, size_t workers, double& makespan);
+
+	/**
+	* Registers a worker and returns its slot. The first workers are given
+	* the seeded deques, later ones start empty and steal.
+	**/
+	size_t addWorker();
+
+	/**
+	* Returns the next test id for the worker in slot, or -1 once every
+	* test has been handed out. Ids left by a worker that stops calling
+	* next are stolen by the others.
+	*
+	* @slot[in] - value returned by addWorker
+	**/
+	int next(size_t slot);
+
+	/**
+	* Removes and returns every id not yet handed out. Workers then run
+	* out of work as soon as they finish their current test.
+	**/
+	std::vector<int> drain();
+
+	/**
+	* Returns the number of successful steals so far
+	**/
+	size_t steals() const;
+
+private:
+	struct WorkDeque
+	{
+		std::mutex mtx;
+		std::deque<int> ids;
+	};
+
+	/**
+	* Moves half of the first non-empty deque found after thief into the
+	* thief's deque. Returns false if nothing was found.
+	**/
+	bool steal(size_t thief);
+
+	// one deque per slot; slots are never removed during a run
+	std::vector<std::unique_ptr<WorkDeque>> deques;
+	std::shared_mutex dequesMtx;
+	// number of slots handed out by addWorker
+	size_t slotsUsed = 0;
+	// ids not yet returned by next
+	std::atomic<size_t> remaining;
+	std::atomic<size_t> stealCount{ 0 };
+};
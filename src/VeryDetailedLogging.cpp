@@ -1,20 +1,34 @@
 #include "VeryDetailedLogging.h"
+#include <cstdio>
 
 VeryDetailedLogging::VeryDetailedLogging() : Logging(LoggingLevel::VERY_DETAILED) {}
 
-void VeryDetailedLogging::DisplayResult(TestResult& result) 
+VeryDetailedLogging::~VeryDetailedLogging()
+{
+    Stop();
+}
+
+void VeryDetailedLogging::FormatResult(const TestResult& result, string& out)
 {
     // Log test name
-    cout << result.getTestName() << endl;
+    out += result.getTestName();
+    out += '\n';
     // Log PASS/FAIL.
-    cout << SuccessValue(result.getIsSuccessful()) << endl;
+    out += SuccessValue(result);
+    out += '\n';
     // Log test specific message.
-    cout << result.getMessage() << endl;
+    out += result.getMessage();
+    out += '\n';
     // Log start date and time.
-    cout << "Function Start Date and Time: " << result.getFunctionStartDateTime();
+    out += "Function Start Date and Time: ";
+    out += result.getFunctionStartDateTime();
     // Log end date and time.
-    cout << "Function End Date and Time: " << result.getFunctionEndDateTime();
+    out += "Function End Date and Time: ";
+    out += result.getFunctionEndDateTime();
     // Log execution duration.
-    cout << "Total Function Run Time: " << std::fixed << result.getFunctionExecutionTime() << std::setprecision(5);
-    cout << " sec(s)" << endl;
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%.5f", result.getFunctionExecutionTime());
+    out += "Total Function Run Time: ";
+    out += seconds;
+    out += " sec(s)\n";
 }
\ No newline at end of file
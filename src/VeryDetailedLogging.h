@@ -3,7 +3,8 @@
 
     This file contains the declaration and implementation of the VeryDetailedLogging class.
     Concrete class that derives from Logging abstract class.
-    Logs PASS/FAIL, test specific message, start and end date/time, and execution duration to console.
+    Formats PASS/FAIL, test specific message, start and end date/time, and execution duration
+    for the console.
 
 */
 
@@ -13,12 +14,6 @@
 #include "TestResult.h"
 #include "Logging.h"
 
-#include <iostream>
-#include <iomanip>
-
-using std::cout;
-using std::endl;
-
 /**
 * Displays a very detailed test result
 **/
@@ -27,7 +22,13 @@ class VeryDetailedLogging : public Logging
 public:
     VeryDetailedLogging();
 
-    void DisplayResult(TestResult& result) override;
+    /**
+    * Writes the queued results before the formatter goes away
+    **/
+    ~VeryDetailedLogging() override;
+
+protected:
+    void FormatResult(const TestResult& result, string& out) override;
 };
 
 #endif /* VeryDetailedLogging_h */
@@ -11,16 +11,22 @@
 //              jfawcett@twcny.rr.com                                //
 ///////////////////////////////////////////////////////////////////////
 
+#include <string>
+#include "WindowsHelpers.h"
+
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 
 #include <Windows.h>
-#include <string>
 #include <winsock2.h>
-#include "WindowsHelpers.h"
-
-using namespace WindowsHelpers;
 
 #pragma comment(lib, "Ws2_32.lib")
+#else
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace WindowsHelpers;
 
 std::string WindowsHelpers::wstringToString(const std::wstring& wstr)
 {
@@ -44,6 +50,13 @@ std::wstring WindowsHelpers::stringToWideString(const std::string& str)
 
 std::string WindowsHelpers::GetLastMsg(bool WantSocketMsg) {
 
+#ifndef _WIN32
+  // POSIX reports socket and system errors the same way, through errno
+  (void)WantSocketMsg;
+  if (errno == 0)
+    return "no error";
+  return std::strerror(errno);
+#else
   // ask system what type of error occurred
 
   DWORD errorCode;
@@ -73,6 +86,7 @@ std::string WindowsHelpers::GetLastMsg(bool WantSocketMsg) {
   std::string _msg(lpBuffer);
   LocalFree(lpBuffer);
   return _msg;
+#endif
 }
 
 #ifdef TEST_WINDOWSHELPERS
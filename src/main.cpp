@@ -9,8 +9,19 @@
 #include "BasicLogging.h"
 #include "DetailedLogging.h"
 #include "VeryDetailedLogging.h"
+#include "JUnitLogging.h"
+#include "JsonLinesLogging.h"
+#include "JournalLogging.h"
+#include "ResultJournal.h"
+#include <iomanip>
+#include <sstream>
+#include <ctime>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
 #include "LambdaTest.h"
 #include "FunctionPointerTest.h"
+#include "CallableTest.h"
 
 #ifdef _WIN32
 #include "Windows.h"
@@ -55,8 +66,102 @@ namespace mainFunctions {
 
 using namespace mainFunctions;
 
+// UTC date of a journal time, for reports
+std::string journalDate(int64_t nanoseconds)
+{
+    if (nanoseconds == 0)
+        return "-";
+    std::time_t when = static_cast<std::time_t>(nanoseconds / 1000000000);
+    std::ostringstream date;
+    date << std::put_time(std::gmtime(&when), "%Y-%m-%d %H:%M:%S");
+    return date.str();
+}
+
+// Reads a count from the command line; false unless all of text is a
+//  number from min to max
+bool parseCount(const char* text, size_t min, size_t max, size_t& value)
+{
+    if (!std::isdigit(static_cast<unsigned char>(text[0])))
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long number = std::strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || number < min || number > max)
+        return false;
+    value = static_cast<size_t>(number);
+    return true;
+}
 
-int main()
+// Answers a question about a result journal; returns the exit code
+int reportJournal(const std::string& path, const std::string& query, int argc, char* argv[])
+{
+    ResultJournal journal;
+    if (!journal.open(path))
+    {
+        std::cout << "can't read journal " << path << std::endl;
+        return 1;
+    }
+    std::cout << journal.size() << " results in " << path << "\n";
+    if (query == "failures")
+    {
+        for (const TestFailures& test : journal.failuresByTest())
+            std::cout << std::setw(8) << test.failures << " of " << std::setw(8) << test.runs
+                << "  last " << journalDate(test.lastFailure) << "  " << test.name << "\n";
+    }
+    else if (query == "slowest")
+    {
+        size_t count = 10;
+        if (argc > 0 && !parseCount(argv[0], 1, 1000000, count))
+        {
+            std::cout << "usage: harness report <path> slowest [count], count from 1 to 1000000" << std::endl;
+            return 1;
+        }
+        for (const TestDurations& test : journal.slowestTests(count))
+            std::cout << std::fixed << std::setprecision(6) << "mean " << test.meanSeconds << " sec(s)  max "
+                << test.maxSeconds << " sec(s)  runs " << test.runs << "  " << test.name << "\n";
+    }
+    else if (query == "trend" && argc > 0)
+    {
+        size_t points = 10;
+        if (argc > 1 && !parseCount(argv[1], 1, 1000000, points))
+        {
+            std::cout << "usage: harness report <path> trend <test> [points], points from 1 to 1000000" << std::endl;
+            return 1;
+        }
+        for (const DurationPoint& point : journal.durationTrend(argv[0], points))
+            std::cout << journalDate(point.start) << "  runs " << std::setw(8) << point.runs
+                << std::fixed << std::setprecision(6) << "  mean " << point.meanSeconds << " sec(s)\n";
+    }
+    else
+    {
+        std::cout << "unknown query " << query << std::endl;
+        return 1;
+    }
+    std::cout << std::flush;
+    return 0;
+}
+
+
+// Usage:
+//    harness                                            runs the tests here
+//    harness coordinator <host:port>                    hands the tests to agents
+//    harness agent <host:port> <host:port> [slots]      runs tests for the coordinator
+//                                                       at the first end point
+//    harness library <path> [path...]                   runs the tests in shared
+//                                                       libraries instead
+//    harness cached [--force]                           runs the tests here, reporting
+//                                                       those that passed before and
+//                                                       haven't changed from the cache
+//    harness junit <path>                               runs the tests here, writing
+//                                                       the results as JUnit XML
+//    harness jsonl <path>                               runs the tests here, writing
+//                                                       the results as JSON Lines
+//    harness journal <path>                             runs the tests here, appending
+//                                                       the results to a result journal
+//    harness report <path> failures                     tests that failed in a journal
+//    harness report <path> slowest [count]              tests with the longest mean time
+//    harness report <path> trend <test> [points]        mean time of a test over its history
+int main(int argc, char* argv[])
 {
     // Create series of test functions.
 
@@ -82,7 +187,7 @@ int main()
 
     // 3. Functor test - will FAIL
     is_between_10_and_30_Functor is_between_10_and_30;
-    LambdaTest test3(is_between_10_and_30, "Is between 10 and 30", "Functor test failed! val1 is not between 10 and 30!");
+    CallableTest<is_between_10_and_30_Functor> test3(is_between_10_and_30, "Is between 10 and 30", "Functor test failed! val1 is not between 10 and 30!");
 
 
     // 4. Lamdba test - will PASS
@@ -103,7 +208,7 @@ int main()
 
     // 6. Functor test - will PASS
     is_between_5_and_80_Functor is_between_5_and_80;
-    LambdaTest test6(is_between_5_and_80, "Is between 5 and 50", "Functor test failed! val1 is not between 5 and 80!");
+    CallableTest<is_between_5_and_80_Functor> test6(is_between_5_and_80, "Is between 5 and 50", "Functor test failed! val1 is not between 5 and 80!");
 
 
     // 7. Test will generate an exception - WILL FAIL
@@ -147,9 +252,101 @@ int main()
     tests.push_back(&test7);
 
 
+    // durations kept between runs, so the longest tests start first
+    const std::string historyFile = "TestHarness.history";
+
+    std::string role = argc > 1 ? argv[1] : "";
+    if (role == "library" && argc > 2)
+    {
+        TestHarness testHarness(logging);
+        try
+        {
+            for (int x = 2; x < argc; x++)
+                testHarness.addLibrary(argv[x]);
+        }
+        catch (std::exception& ex)
+        {
+            std::cout << ex.what() << std::endl;
+            return 1;
+        }
+        testHarness.setHistoryFile(historyFile);
+        testHarness.run();
+        TestLibraries::instance().report(std::cout);
+        return 0;
+    }
+    if (role == "cached")
+    {
+        TestHarness testHarness(logging);
+        for (ITest* test : tests)
+            testHarness.addTest(test);
+        testHarness.setHistoryFile(historyFile);
+        testHarness.setResultCacheFile("TestHarness.cache");
+        testHarness.setForceRun(argc > 2 && std::string(argv[2]) == "--force");
+        testHarness.run();
+        return 0;
+    }
+    if (role == "report" && argc > 3)
+    {
+        delete logging;
+        return reportJournal(argv[2], argv[3], argc - 4, argv + 4);
+    }
+    if ((role == "junit" || role == "jsonl" || role == "journal") && argc > 2)
+    {
+        delete logging;
+        try
+        {
+            if (role == "junit")
+                logging = new JUnitLogging(argv[2]);
+            else if (role == "jsonl")
+                logging = new JsonLinesLogging(argv[2]);
+            else
+                logging = new JournalLogging(argv[2]);
+        }
+        catch (std::exception& ex)
+        {
+            std::cout << ex.what() << std::endl;
+            return 1;
+        }
+        TestHarness testHarness(logging);
+        for (ITest* test : tests)
+            testHarness.addTest(test);
+        testHarness.setHistoryFile(historyFile);
+        testHarness.run();
+        return 0;
+    }
+    if (role == "coordinator" && argc > 2)
+    {
+        TestHarness testHarness(logging);
+        for (ITest* test : tests)
+            testHarness.addTest(test);
+        testHarness.setHistoryFile(historyFile);
+        testHarness.setCoordinator(MsgPassingCommunication::EndPoint::fromString(argv[2]));
+        testHarness.run(ExecutionMode::DISTRIBUTED);
+        return 0;
+    }
+    if (role == "agent" && argc > 3)
+    {
+        TestHarness testHarness(logging);
+        for (ITest* test : tests)
+            testHarness.addTest(test);
+        testHarness.setHistoryFile(historyFile);
+        size_t slots = 0;
+        if (argc > 4 && !parseCount(argv[4], 1, 1024, slots))
+        {
+            std::cout << "usage: harness agent <host:port> <host:port> [slots], slots from 1 to 1024" << std::endl;
+            return 1;
+        }
+        testHarness.runAgent(MsgPassingCommunication::EndPoint::fromString(argv[2]), MsgPassingCommunication::EndPoint::fromString(argv[3]), slots);
+        return 0;
+    }
+
     // create the test harness
     // use dependency injection to inject the logging
-    TestHarness testHarness(logging, tests);
+    TestHarness testHarness(logging);
+    for (ITest* test : tests)
+        testHarness.addTest(test);
+    testHarness.setHistoryFile(historyFile);
+    testHarness.run();
 
     return 0;
 }